@@ -4,17 +4,29 @@ in vec2 uv;
 flat in int texture_index;
 uniform sampler2DArray textures;
 
-flat in vec3 current_world_pos;
-uniform vec3 selected_world_pos;
+in vec3 world_pos;
+flat in vec3 normal;
+// uploaded once per frame, see FrameUniforms in src/shader.h
+layout (std140, binding = 1) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 selected_world_pos;
+};
 
 out vec4 fragment_color;
 
 void main()
 {
-    // inner or outer edge
+    // faces sit half a voxel away from the center of the voxel they belong to
+    vec3 voxel_pos = round(world_pos - normal * 0.5);
+
+    // inner or outer edge, quads can span multiple voxels so the
+    // texture coordinates repeat once per voxel
     float threshold = 0.02;
-    bool is_edge = min(uv.x, uv.y) < threshold || max(uv.x, uv.y) > (1.0 - threshold);
-    bool highlight = is_edge && current_world_pos == selected_world_pos;
+    vec2 voxel_uv = fract(uv);
+    bool is_edge = min(voxel_uv.x, voxel_uv.y) < threshold
+        || max(voxel_uv.x, voxel_uv.y) > (1.0 - threshold);
+    bool highlight = is_edge && voxel_pos == selected_world_pos;
     if (highlight)
         fragment_color = vec4(1, 1, 1, 1);
     else
@@ -1,23 +1,54 @@
 #version 460 core
 
-layout (location = 0) in vec3 pos;
-layout (location = 1) in vec3 coord;
-layout (location = 2) in vec3 world_pos;
+// see Vertex in src/vertex.h for the layout
+layout (location = 0) in uint packed_vertex;
 
-uniform mat4 view;
-uniform mat4 projection;
+// uploaded once per frame, see FrameUniforms in src/shader.h
+layout (std140, binding = 1) uniform Frame {
+    mat4 projection;
+    mat4 view;
+    vec3 selected_world_pos;
+};
 
-flat out vec3 current_world_pos;
+// the world position of each draw's chunk, indexed by the draw's base instance,
+// see DrawList in src/draw.h
+layout (std430, binding = 0) readonly buffer ChunkOffsets {
+    vec4 chunk_offsets[];
+};
+
+out vec3 world_pos;
+flat out vec3 normal;
 
 out vec2 uv;
 flat out int texture_index;
 
+const vec3 normals[6] = vec3[](
+    vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0),
+    vec3(0, -1, 0), vec3(0, 0, 1), vec3(0, 0, -1)
+);
+
+// the texture's u and v coordinates run along these axes for each face,
+// so that the texture repeats once per voxel on merged quads
+const vec3 u_axes[6] = vec3[](
+    vec3(0, 0, -1), vec3(0, 0, 1), vec3(1, 0, 0),
+    vec3(1, 0, 0), vec3(1, 0, 0), vec3(-1, 0, 0)
+);
+const vec3 v_axes[6] = vec3[](
+    vec3(0, 1, 0), vec3(0, 1, 0), vec3(0, 0, -1),
+    vec3(0, 0, 1), vec3(0, 1, 0), vec3(0, 1, 0)
+);
+
 void main()
 {
-    // vertex positions are already transformed during chunk mesh generation
-    current_world_pos = world_pos;
-    gl_Position = projection * view * vec4(pos, 1.0);
+    vec3 pos = vec3(packed_vertex & 63u, (packed_vertex >> 6) & 63u,
+        (packed_vertex >> 12) & 63u);
+    int face = int((packed_vertex >> 18) & 7u);
+    texture_index = int((packed_vertex >> 21) & 255u);
+
+    // positions are voxel corners, voxels are centered on their coordinates
+    world_pos = chunk_offsets[gl_BaseInstance].xyz + pos - 0.5;
+    normal = normals[face];
+    gl_Position = projection * view * vec4(world_pos, 1.0);
 
-    uv = coord.xy;
-    texture_index = int(coord.z);
+    uv = vec2(dot(pos, u_axes[face]), dot(pos, v_axes[face]));
 }
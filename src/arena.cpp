@@ -0,0 +1,187 @@
+#include <algorithm>
+#include <cstddef>
+#include <glad/glad.h>
+
+#include "arena.h"
+
+QuadIndexBuffer::QuadIndexBuffer()
+{
+    std::vector<uint16_t> indices(MAX_QUADS * 6);
+    const uint16_t quad[] = { 0, 1, 2, 0, 2, 3 };
+    for (int i = 0; i < MAX_QUADS * 6; i++)
+        indices[i] = (i / 6) * 4 + quad[i % 6];
+
+    glGenBuffers(1, &m_ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t),
+        indices.data(), GL_STATIC_DRAW);
+}
+
+QuadIndexBuffer::~QuadIndexBuffer() { glDeleteBuffers(1, &m_ebo); }
+
+VertexArena::VertexArena(const QuadIndexBuffer& indices, int capacity)
+    : m_capacity(capacity),
+      m_used(0)
+{
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+    // the vertex array keeps the shared index buffer bound
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.id());
+
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    glVertexAttribIPointer(
+        0, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, data));
+    glEnableVertexAttribArray(0); // packed vertex
+
+    m_free[0] = capacity;
+}
+
+VertexArena::~VertexArena()
+{
+    glDeleteBuffers(1, &m_vbo);
+    glDeleteVertexArrays(1, &m_vao);
+}
+
+VertexArena::Handle VertexArena::allocate(const std::vector<Vertex>& vertices)
+{
+    int size = vertices.size();
+    if (size == 0)
+        return NONE;
+
+    // the smallest free range the vertices fit in
+    auto best = m_free.end();
+    for (auto it = m_free.begin(); it != m_free.end(); it++) {
+        if (it->second >= size && (best == m_free.end() || it->second < best->second))
+            best = it;
+    }
+    if (best == m_free.end()) {
+        reallocate(std::max(m_capacity * 2, m_capacity + size), false);
+        return allocate(vertices);
+    }
+
+    auto [offset, free_size] = *best;
+    m_free.erase(best);
+    if (free_size > size)
+        m_free[offset + size] = free_size - size;
+    m_used += size;
+
+    Handle handle;
+    if (!m_unused_handles.empty()) {
+        handle = m_unused_handles.back();
+        m_unused_handles.pop_back();
+        m_allocations[handle] = { offset, size };
+    } else {
+        handle = m_allocations.size();
+        m_allocations.push_back({ offset, size });
+    }
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferSubData(
+        GL_ARRAY_BUFFER, offset * sizeof(Vertex), size * sizeof(Vertex), vertices.data());
+    return handle;
+}
+
+void VertexArena::free(Handle handle)
+{
+    if (handle == NONE)
+        return;
+
+    Allocation& allocation = m_allocations[handle];
+    add_free_range(allocation.offset, allocation.size);
+    m_used -= allocation.size;
+    allocation = { 0, 0 };
+    m_unused_handles.push_back(handle);
+}
+
+void VertexArena::add_free_range(int offset, int size)
+{
+    // merge with the free ranges on either side
+    auto next = m_free.find(offset + size);
+    if (next != m_free.end()) {
+        size += next->second;
+        m_free.erase(next);
+    }
+
+    auto previous = m_free.lower_bound(offset);
+    if (previous != m_free.begin()) {
+        previous--;
+        if (previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+    m_free[offset] = size;
+}
+
+void VertexArena::bind() const { glBindVertexArray(m_vao); }
+
+bool VertexArena::fragmented() const
+{
+    int free = m_capacity - m_used;
+    return free > m_capacity / 4 && stats().largest_free < free / 2;
+}
+
+void VertexArena::defragment() { reallocate(m_capacity, true); }
+
+void VertexArena::reallocate(int capacity, bool compact)
+{
+    unsigned int vbo;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+    glBufferData(
+        GL_COPY_WRITE_BUFFER, capacity * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_READ_BUFFER, m_vbo);
+
+    if (compact) {
+        // copy the allocations over in order, one after the other
+        std::vector<Allocation*> live;
+        for (Allocation& allocation : m_allocations) {
+            if (allocation.size > 0)
+                live.push_back(&allocation);
+        }
+        std::sort(live.begin(), live.end(),
+            [](Allocation* a, Allocation* b) { return a->offset < b->offset; });
+
+        int end = 0;
+        for (Allocation* allocation : live) {
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                allocation->offset * sizeof(Vertex), end * sizeof(Vertex),
+                allocation->size * sizeof(Vertex));
+            allocation->offset = end;
+            end += allocation->size;
+        }
+        m_free.clear();
+        if (end < capacity)
+            m_free[end] = capacity - end;
+    } else {
+        // growing keeps every offset and adds free space at the end
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+            m_capacity * sizeof(Vertex));
+        add_free_range(m_capacity, capacity - m_capacity);
+    }
+
+    glDeleteBuffers(1, &m_vbo);
+    m_vbo = vbo;
+    m_capacity = capacity;
+
+    // point the vertex array at the new buffer
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glVertexAttribIPointer(
+        0, 1, GL_UNSIGNED_INT, sizeof(Vertex), (void*)offsetof(Vertex, data));
+}
+
+ArenaStats VertexArena::stats() const
+{
+    int largest_free = 0;
+    for (const auto& [offset, size] : m_free)
+        largest_free = std::max(largest_free, size);
+
+    return { .capacity = m_capacity,
+        .used = m_used,
+        .allocations = int(m_allocations.size() - m_unused_handles.size()),
+        .free_ranges = int(m_free.size()),
+        .largest_free = largest_free };
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include "vertex.h"
+
+// Every quad is drawn as two triangles with the indices {0, 1, 2, 0, 2, 3} offset
+// by 4 * quad, which is the same for every mesh, so one index buffer holding the
+// pattern is shared by all chunks instead of each mesh carrying its own indices.
+// Indices are 16 bit, meshes with more than MAX_QUADS quads are drawn in batches
+// that each start MAX_QUADS * 4 vertices further into the mesh.
+class QuadIndexBuffer {
+public:
+    QuadIndexBuffer();
+    ~QuadIndexBuffer();
+
+    // disable copy and move constructors
+    QuadIndexBuffer& operator=(const QuadIndexBuffer&) = delete;
+    QuadIndexBuffer(const QuadIndexBuffer&) = delete;
+
+    // the most quads 16 bit indices can address
+    static const int MAX_QUADS = 65536 / 4;
+
+    unsigned int id() const { return m_ebo; }
+
+private:
+    unsigned int m_ebo;
+};
+
+struct ArenaStats {
+    int capacity; // in vertices
+    int used;
+    int allocations;
+    int free_ranges;
+    int largest_free;
+};
+
+// One vertex buffer that every chunk mesh is sub allocated from, with a single
+// vertex array, so chunks don't create and free buffers as they stream in and
+// out and drawing them doesn't switch vertex arrays.
+// Free space is kept as a list of ranges sorted by offset. Allocations take the
+// smallest range they fit in, and freed ranges merge with the ranges next to them.
+// The buffer doubles when nothing fits, and defragment() packs the allocations
+// together when the free space has been split into many small ranges.
+class VertexArena {
+public:
+    // an allocation's offset can change when the arena is defragmented,
+    // so allocations are referred to by handle
+    using Handle = int;
+    static const Handle NONE = -1;
+
+    VertexArena(const QuadIndexBuffer& indices, int capacity = 1 << 20);
+    ~VertexArena();
+
+    // disable copy and move constructors
+    VertexArena& operator=(const VertexArena&) = delete;
+    VertexArena(const VertexArena&) = delete;
+
+    // allocate room for a number of vertices and copy them in,
+    // returns NONE for an empty mesh
+    Handle allocate(const std::vector<Vertex>& vertices);
+    void free(Handle handle);
+    // the index of the allocation's first vertex in the buffer
+    int offset(Handle handle) const { return m_allocations[handle].offset; }
+
+    // bind the vertex array that draws from the arena
+    void bind() const;
+
+    // true when most of the free space is in ranges too small for a typical mesh
+    bool fragmented() const;
+    // move the allocations to the start of the buffer, leaving one free range
+    void defragment();
+    ArenaStats stats() const;
+
+private:
+    struct Allocation {
+        int offset;
+        int size; // 0 for unused handles
+    };
+
+    // copy the allocations into a new buffer, packed together when compact is true
+    void reallocate(int capacity, bool compact);
+    void add_free_range(int offset, int size);
+
+    std::map<int, int> m_free; // offset to size
+    std::vector<Allocation> m_allocations;
+    std::vector<Handle> m_unused_handles;
+    int m_capacity, m_used;
+    unsigned int m_vao, m_vbo;
+};
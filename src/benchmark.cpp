@@ -0,0 +1,629 @@
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <glad/glad.h>
+#include <random>
+#include <unordered_set>
+
+#include "benchmark.h"
+#include "camera.h"
+#include "chunk.h"
+#include "codec.h"
+#include "generator.h"
+#include "jobs.h"
+#include "mesher.h"
+#include "noise.h"
+#include "region.h"
+#include "shader.h"
+#include "spritesheet.h"
+#include "terrain.h"
+#include "utils.h"
+
+// run a function a number of times and return the average time per run in nanoseconds
+template <typename F> double time_ns(int runs, F function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < runs; i++)
+        function();
+    std::chrono::duration<double, std::nano> elapsed
+        = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / runs;
+}
+
+// compare the memory footprint and random access cost of
+// the palette compressed storage against a dense block array
+void benchmark_storage()
+{
+    const int radius = 8;
+    std::vector<VoxelStorage> palettes;
+    std::vector<std::vector<Block>> dense;
+
+    TerrainGenerator generator;
+    size_t palette_bytes = 0;
+    int bits_histogram[9] = { 0 };
+    for (int x = -radius; x <= radius; x++) {
+        for (int z = -radius; z <= radius; z++) {
+            VoxelStorage storage(CHUNK_VOLUME);
+            generator.generate(IVec3(x, 0, z), storage);
+
+            std::vector<Block> blocks(CHUNK_VOLUME);
+            for (int i = 0; i < CHUNK_VOLUME; i++)
+                blocks[i] = storage.get(i);
+
+            palette_bytes += storage.memory_usage();
+            bits_histogram[storage.bits_per_voxel()]++;
+            palettes.push_back(std::move(storage));
+            dense.push_back(std::move(blocks));
+        }
+    }
+
+    size_t count = palettes.size();
+    log("storage: {} chunks", count);
+    log("  dense:   {} bytes/chunk", sizeof(Block) * CHUNK_VOLUME);
+    log("  palette: {} bytes/chunk", palette_bytes / count);
+    for (int bits : { 1, 2, 4, 8 })
+        log("  {} bit chunks: {}", bits, bits_histogram[bits]);
+
+    // the same random access pattern for both layouts
+    std::mt19937 rng(1234);
+    std::vector<std::pair<int, int>> lookups(1 << 20);
+    for (auto& [chunk, index] : lookups) {
+        chunk = rng() % count;
+        index = rng() % CHUNK_VOLUME;
+    }
+
+    int solid = 0;
+    double dense_ns = time_ns(1, [&]() {
+        for (auto [chunk, index] : lookups)
+            solid += dense[chunk][index] != Block::air;
+    });
+    double palette_ns = time_ns(1, [&]() {
+        for (auto [chunk, index] : lookups)
+            solid += palettes[chunk].get(index) != Block::air;
+    });
+
+    log("  dense random access:   {:.2f} ns", dense_ns / lookups.size());
+    log("  palette random access: {:.2f} ns", palette_ns / lookups.size());
+    log("  ({} solid lookups)", solid);
+}
+
+// time each noise backend the cpu supports and
+// check that they all match the scalar version bit for bit
+Result benchmark_noise()
+{
+    const int count = 1 << 16;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coordinate(-5000.0f, 5000.0f);
+    std::vector<float> xs(count), ys(count);
+    for (int i = 0; i < count; i++) {
+        xs[i] = coordinate(rng);
+        ys[i] = coordinate(rng);
+    }
+
+    std::vector<float> expected(count), values(count);
+    perlin_noise(xs.data(), ys.data(), expected.data(), count, 0, NoiseBackend::scalar);
+
+    log("noise: {} points, using {}", count, noise_backend_name(noise_backend()));
+    Result result;
+    auto backends = { NoiseBackend::scalar, NoiseBackend::sse41, NoiseBackend::avx2 };
+    for (NoiseBackend backend : backends) {
+        if (backend > noise_backend())
+            continue; // backends are ordered by the instruction sets they need
+
+        double ns = time_ns(20, [&]() {
+            perlin_noise(xs.data(), ys.data(), values.data(), count, 0, backend);
+        });
+        bool identical
+            = std::memcmp(values.data(), expected.data(), count * sizeof(float)) == 0;
+        log("  {}: {:.2f} ns/point, {}", noise_backend_name(backend), ns / count,
+            identical ? "matches scalar" : "MISMATCH");
+        if (!identical) {
+            result = Result("The {} noise doesn't match the scalar noise",
+                noise_backend_name(backend));
+        }
+    }
+    return result;
+}
+
+// time each generation stage on one core, the stages share the fields of a
+// chunk so they're timed in order on the same fields
+void benchmark_generation()
+{
+    const int num_chunks = 512;
+    TerrainGenerator generator;
+    double stage_ns[4] = { 0 };
+    VoxelStorage voxels(CHUNK_VOLUME);
+
+    for (int i = 0; i < num_chunks; i++) {
+        ColumnFields fields(IVec3(i % 32, 0, i / 32));
+        voxels.fill(Block::air);
+        for (GenerationStage stage : generator.stages()) {
+            stage_ns[int(stage)] += time_ns(
+                1, [&]() { generator.run_stage(stage, fields, voxels); });
+        }
+    }
+
+    log("generation: {} chunks on one core", num_chunks);
+    double total_ns = 0;
+    for (GenerationStage stage : generator.stages()) {
+        double ns = stage_ns[int(stage)] / num_chunks;
+        total_ns += ns;
+        log("  {}: {:.1f} us/chunk, {:.0f} chunks/s", stage_name(stage), ns / 1000.0,
+            1e9 / ns);
+    }
+    log("  total: {:.1f} us/chunk, {:.0f} chunks/s", total_ns / 1000.0, 1e9 / total_ns);
+}
+
+// compare loading a region of chunks from a save file against generating them
+void benchmark_regions()
+{
+    auto directory = std::filesystem::temp_directory_path() / "voxel_benchmark_world";
+    std::filesystem::remove_all(directory);
+
+    TerrainGenerator generator;
+    std::vector<VoxelStorage> chunks(REGION_CHUNKS, VoxelStorage(CHUNK_VOLUME));
+    double generate_ns = time_ns(1, [&]() {
+        for (int i = 0; i < REGION_CHUNKS; i++)
+            generator.generate(IVec3(i / REGION_SIZE, 0, i % REGION_SIZE), chunks[i]);
+    });
+
+    double save_ns = time_ns(1, [&]() {
+        RegionStore store(directory.string());
+        for (int i = 0; i < REGION_CHUNKS; i++) {
+            IVec3 chunk_pos(i / REGION_SIZE, 0, i % REGION_SIZE);
+            Result result = store.save(chunk_pos, chunks[i]);
+            if (result.is_err())
+                log(Level::error, result.error());
+        }
+    });
+
+    // a fresh store has to open the region file again
+    int mismatched = 0;
+    std::vector<VoxelStorage> loaded(REGION_CHUNKS, VoxelStorage(CHUNK_VOLUME));
+    double load_ns = time_ns(1, [&]() {
+        RegionStore store(directory.string());
+        for (int i = 0; i < REGION_CHUNKS; i++) {
+            ResultOr<bool> found
+                = store.load(IVec3(i / REGION_SIZE, 0, i % REGION_SIZE), loaded[i]);
+            mismatched += found.is_err() || !found.value();
+        }
+    });
+    for (int i = 0; i < REGION_CHUNKS; i++) {
+        for (int v = 0; v < CHUNK_VOLUME; v++) {
+            if (loaded[i].get(v) != chunks[i].get(v)) {
+                mismatched++;
+                break;
+            }
+        }
+    }
+
+    size_t file_size = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory))
+        file_size += entry.file_size();
+    std::filesystem::remove_all(directory);
+
+    log("regions: {} chunks", REGION_CHUNKS);
+    log("  generate: {:.1f} us/chunk", generate_ns / REGION_CHUNKS / 1000.0);
+    log("  save:     {:.1f} us/chunk", save_ns / REGION_CHUNKS / 1000.0);
+    log("  load:     {:.1f} us/chunk", load_ns / REGION_CHUNKS / 1000.0);
+    log("  {} bytes/chunk on disk, {} chunks differ after loading",
+        file_size / REGION_CHUNKS, mismatched);
+}
+
+// how small each stage of the chunk codec makes chunks and how fast it runs
+void benchmark_codec()
+{
+    const int radius = 8;
+    TerrainGenerator generator;
+    std::vector<VoxelStorage> chunks;
+    for (int x = -radius; x <= radius; x++) {
+        for (int z = -radius; z <= radius; z++) {
+            VoxelStorage storage(CHUNK_VOLUME);
+            generator.generate(IVec3(x, 0, z), storage);
+            chunks.push_back(std::move(storage));
+        }
+    }
+
+    size_t palette_bytes = 0, column_bytes = 0, compressed_bytes = 0;
+    std::vector<std::vector<uint8_t>> compressed(chunks.size());
+    double encode_ns = time_ns(1, [&]() {
+        for (size_t i = 0; i < chunks.size(); i++)
+            compressed[i] = compress_chunk(chunks[i]);
+    });
+    for (size_t i = 0; i < chunks.size(); i++) {
+        palette_bytes += chunks[i].memory_usage();
+        column_bytes += encode_columns(chunks[i]).size();
+        compressed_bytes += compressed[i].size();
+    }
+
+    int mismatched = 0;
+    std::vector<VoxelStorage> decoded(chunks.size(), VoxelStorage(CHUNK_VOLUME));
+    double decode_ns = time_ns(1, [&]() {
+        for (size_t i = 0; i < chunks.size(); i++) {
+            Result result = decompress_chunk(
+                compressed[i].data(), compressed[i].size(), decoded[i]);
+            mismatched += result.is_err();
+        }
+    });
+    for (size_t i = 0; i < chunks.size(); i++) {
+        for (int v = 0; v < CHUNK_VOLUME; v++) {
+            if (decoded[i].get(v) != chunks[i].get(v)) {
+                mismatched++;
+                break;
+            }
+        }
+    }
+
+    // throughput is measured over the chunks' dense size
+    size_t count = chunks.size();
+    double dense_bytes = double(sizeof(Block) * CHUNK_VOLUME) * count;
+    log("codec: {} chunks", count);
+    log("  dense:          {} bytes/chunk", sizeof(Block) * CHUNK_VOLUME);
+    log("  palette:        {} bytes/chunk", palette_bytes / count);
+    log("  column runs:    {} bytes/chunk", column_bytes / count);
+    log("  runs + lz:      {} bytes/chunk, {:.0f}x smaller than dense",
+        compressed_bytes / count, dense_bytes / compressed_bytes);
+    log("  encode: {:.0f} MB/s, {:.1f} us/chunk", dense_bytes / encode_ns * 1000.0,
+        encode_ns / count / 1000.0);
+    log("  decode: {:.0f} MB/s, {:.1f} us/chunk", dense_bytes / decode_ns * 1000.0,
+        decode_ns / count / 1000.0);
+    log("  {} chunks differ after decoding", mismatched);
+}
+
+// compare the size of the meshes each mesher builds and how long they take
+void benchmark_meshing()
+{
+    const int radius = 4;
+    TerrainGenerator generator;
+    std::vector<VoxelStorage> chunks;
+    for (int x = -radius - 1; x <= radius + 1; x++) {
+        for (int z = -radius - 1; z <= radius + 1; z++) {
+            VoxelStorage storage(CHUNK_VOLUME);
+            generator.generate(IVec3(x, 0, z), storage);
+            chunks.push_back(std::move(storage));
+        }
+    }
+
+    // mesh the inner chunks against their neighbours
+    std::vector<MeshVolume> volumes;
+    int side = radius * 2 + 3;
+    for (int x = 1; x < side - 1; x++) {
+        for (int z = 1; z < side - 1; z++) {
+            std::array<const VoxelStorage*, 4> neighbours;
+            for (int i = 0; i < 4; i++) {
+                IVec3 n = IVec3(x, 0, z) + CHUNK_NEIGHBOURS[i];
+                neighbours[i] = &chunks[n.x * side + n.z];
+            }
+            volumes.push_back(MeshVolume(chunks[x * side + z], neighbours));
+        }
+    }
+
+    log("meshing: {} chunks", volumes.size());
+    for (MeshMode mode : { MeshMode::naive, MeshMode::greedy, MeshMode::binary }) {
+        Mesh mesh;
+        size_t vertices = 0;
+        double ns = time_ns(10, [&]() {
+            vertices = 0;
+            for (const MeshVolume& volume : volumes) {
+                build_mesh(mode, volume, mesh);
+                vertices += mesh.vertices.size();
+            }
+        });
+
+        // indices come from the shared quad index buffer, so only vertices are uploaded
+        log("  {}: {} vertices/chunk, {} bytes/chunk, {:.1f} us/chunk",
+            mesh_mode_name(mode), vertices / volumes.size(),
+            vertices * sizeof(Vertex) / volumes.size(), ns / volumes.size() / 1000.0);
+    }
+    log("  shared quad index buffer: {} bytes",
+        QuadIndexBuffer::MAX_QUADS * 6 * sizeof(uint16_t));
+
+    // distant chunks are downsampled before they're meshed, which is timed too
+    for (int lod = 1; lod <= MAX_LOD; lod++) {
+        Mesh mesh;
+        size_t vertices = 0;
+        double ns = time_ns(10, [&]() {
+            vertices = 0;
+            for (int x = 1; x < side - 1; x++) {
+                for (int z = 1; z < side - 1; z++) {
+                    build_mesh(MeshMode::binary,
+                        MeshVolume(chunks[x * side + z], {}, lod), mesh);
+                    vertices += mesh.vertices.size();
+                }
+            }
+        });
+        log("  binary, lod {}: {} vertices/chunk, {:.1f} us/chunk", lod,
+            vertices / volumes.size(), ns / volumes.size() / 1000.0);
+    }
+}
+
+// the per frame cost of remeshing the chunks a burst of edits touched,
+// each dirty chunk is meshed once however many of its voxels changed
+void benchmark_edits()
+{
+    const int side = 5; // the outer ring only provides neighbours
+    TerrainGenerator generator;
+    std::vector<VoxelStorage> chunks;
+    for (int x = 0; x < side; x++) {
+        for (int z = 0; z < side; z++) {
+            VoxelStorage storage(CHUNK_VOLUME);
+            generator.generate(IVec3(x, 0, z), storage);
+            chunks.push_back(std::move(storage));
+        }
+    }
+
+    log("edits: remeshing dirty chunks with the binary mesher");
+    std::mt19937 rng(1234);
+    for (int edits : { 1, 16, 256 }) {
+        const int frames = 50;
+        size_t dirty_chunks = 0;
+        double ns = 0;
+        for (int frame = 0; frame < frames; frame++) {
+            // random edits within the inner chunks, marking neighbours on borders
+            std::unordered_set<IVec3, IVec3Hasher> dirty;
+            for (int i = 0; i < edits; i++) {
+                int x = CHUNK_SIZE + rng() % (CHUNK_SIZE * (side - 2));
+                int z = CHUNK_SIZE + rng() % (CHUNK_SIZE * (side - 2));
+                int y = rng() % CHUNK_HEIGHT;
+                IVec3 chunk(x / CHUNK_SIZE, 0, z / CHUNK_SIZE);
+                int local_x = x % CHUNK_SIZE, local_z = z % CHUNK_SIZE;
+                chunks[chunk.x * side + chunk.z].set(
+                    Chunk::voxel_index(local_x, y, local_z), Block(rng() % NUM_BLOCKS));
+
+                dirty.insert(chunk);
+                if (local_x == 0 || local_x == CHUNK_SIZE - 1)
+                    dirty.insert(chunk + IVec3(local_x == 0 ? -1 : 1, 0, 0));
+                if (local_z == 0 || local_z == CHUNK_SIZE - 1)
+                    dirty.insert(chunk + IVec3(0, 0, local_z == 0 ? -1 : 1));
+            }
+
+            Mesh mesh;
+            dirty_chunks += dirty.size();
+            ns += time_ns(1, [&]() {
+                for (IVec3 chunk : dirty) {
+                    std::array<const VoxelStorage*, 4> neighbours = { nullptr };
+                    for (int i = 0; i < 4; i++) {
+                        IVec3 n = chunk + CHUNK_NEIGHBOURS[i];
+                        if (n.x >= 0 && n.x < side && n.z >= 0 && n.z < side)
+                            neighbours[i] = &chunks[n.x * side + n.z];
+                    }
+                    MeshVolume volume(chunks[chunk.x * side + chunk.z], neighbours);
+                    build_mesh(MeshMode::binary, volume, mesh);
+                }
+            });
+        }
+
+        log("  {} edits/frame: {:.1f} dirty chunks, {:.2f} ms/frame of a 16.7 ms frame",
+            edits, double(dirty_chunks) / frames, ns / frames / 1e6);
+    }
+}
+
+// writing a box of voxels one voxel at a time against a column range at a time
+void benchmark_bulk_edits()
+{
+    const int side = 5;
+    TerrainGenerator generator;
+    std::vector<VoxelStorage> chunks;
+    for (int i = 0; i < side * side; i++) {
+        VoxelStorage storage(CHUNK_VOLUME);
+        generator.generate(IVec3(i / side, 0, i % side), storage);
+        chunks.push_back(std::move(storage));
+    }
+
+    // the box covers every chunk, from just above the bottom to just below the top
+    int y_begin = 1, y_end = CHUNK_HEIGHT - 1;
+    double voxel_ns = time_ns(10, [&]() {
+        for (VoxelStorage& storage : chunks) {
+            for (int column = 0; column < CHUNK_AREA; column++) {
+                for (int y = y_begin; y < y_end; y++)
+                    storage.set(column * CHUNK_HEIGHT + y, Block::grass);
+            }
+        }
+    });
+    double column_ns = time_ns(10, [&]() {
+        for (VoxelStorage& storage : chunks) {
+            for (int column = 0; column < CHUNK_AREA; column++) {
+                int begin = column * CHUNK_HEIGHT;
+                storage.fill(begin + y_begin, begin + y_end, Block::dirt);
+            }
+        }
+    });
+
+    int voxels = side * side * CHUNK_AREA * (y_end - y_begin);
+    log("bulk edits: a {} voxel box across {} chunks", voxels, side * side);
+    log("  per voxel:  {:.2f} ms", voxel_ns / 1e6);
+    log("  per column: {:.2f} ms", column_ns / 1e6);
+}
+
+// chunks generated and meshed per second as the number of workers grows
+void benchmark_jobs()
+{
+    const int num_chunks = 512;
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    log("jobs: generating and meshing {} chunks", num_chunks);
+    TerrainGenerator generator;
+
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        JobPool pool(threads);
+        double ns = time_ns(1, [&]() {
+            for (int i = 0; i < num_chunks; i++) {
+                pool.submit(make_cancel_token(), [&generator, i]() {
+                    VoxelStorage voxels(CHUNK_VOLUME);
+                    generator.generate(IVec3(i % 32, 0, i / 32), voxels);
+                    Mesh mesh;
+                    build_mesh(MeshMode::binary, MeshVolume(voxels, {}), mesh);
+                });
+            }
+            pool.wait();
+        });
+        log("  {} threads: {:.0f} chunks/s", threads, num_chunks / (ns / 1e9));
+    }
+}
+
+// draw the terrain from above with a render path and read back the pixels
+std::vector<uint8_t> render_image(
+    Terrain& terrain, ShaderManager& shaders, RenderPath path)
+{
+    int viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    Camera camera;
+    camera.position = Vec3(-30, 50, -30);
+    camera.front = Vec3(1, -1, 1).norm();
+    Matrix4 projection = Matrix4::projection(
+        0.1, 200.0, 45 * (M_PI / 180.0), float(viewport[2]) / viewport[3]);
+    shaders.set_frame(projection, camera.look_at(), Vec3(0, 0, 0));
+
+    glClearColor(1, 1, 1, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    terrain.set_render_path(path);
+    terrain.render(Frustum(projection * camera.look_at()));
+
+    std::vector<uint8_t> pixels(viewport[2] * viewport[3] * 4);
+    glReadPixels(
+        0, 0, viewport[2], viewport[3], GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    return pixels;
+}
+
+Result benchmark_rendering()
+{
+    // the first load compiles and fills the cache, the second loads the binary
+    auto cache = std::filesystem::temp_directory_path() / "voxel_benchmark_shaders";
+    std::filesystem::remove_all(cache);
+    ShaderManager compiled, shaders;
+    Result result;
+    double compile_ns = time_ns(1, [&]() {
+        result = compiled.load("assets/shaders/vertex.glsl",
+            "assets/shaders/fragment.glsl", cache.string());
+    });
+    double cached_ns = time_ns(1, [&]() {
+        result = shaders.load("assets/shaders/vertex.glsl",
+            "assets/shaders/fragment.glsl", cache.string());
+    });
+    std::filesystem::remove_all(cache);
+    if (result.is_err()) {
+        return result;
+    }
+    shaders.use();
+
+    log("shaders: {:.2f} ms compiling, {:.2f} ms from the program binary cache",
+        compile_ns / 1e6, cached_ns / 1e6);
+
+    // the first load decodes the png and bakes it, the second maps the baked file
+    auto texture_cache
+        = std::filesystem::temp_directory_path() / "voxel_benchmark_textures";
+    std::filesystem::remove_all(texture_cache);
+    Spritesheet baked, mapped;
+    double bake_ns = time_ns(1, [&]() {
+        result = baked.load(
+            "assets/textures/atlas.png", 64, BLOCK_TEXTURES, texture_cache.string());
+    });
+    double map_ns = time_ns(1, [&]() {
+        result = mapped.load(
+            "assets/textures/atlas.png", 64, BLOCK_TEXTURES, texture_cache.string());
+    });
+    std::filesystem::remove_all(texture_cache);
+    if (result.is_err()) {
+        return result;
+    }
+    log("textures: {:.2f} ms decoding and baking, {:.2f} ms from the baked cache",
+        bake_ns / 1e6, map_ns / 1e6);
+    {
+        // coarse chunks contain their full resolution voxels and close off their
+        // sides, so lod can only cover more of the background, never less
+        const int radius = 8, side = radius * 2 + 1;
+        Terrain terrain({ .load_radius = radius,
+            .unload_radius = radius + 1,
+            .max_loaded = side * side,
+            .cache_capacity = 0 });
+        terrain.load_more_chunks(0, 0);
+        terrain.wait_until_loaded();
+
+        std::vector<uint8_t> images[2];
+        int vertices[2];
+        for (int i = 0; i < 2; i++) {
+            // rendering queues the chunks whose level of detail changed
+            terrain.set_lod_distance(i == 0 ? 0 : 2);
+            render_image(terrain, shaders, RenderPath::indirect);
+            terrain.wait_until_loaded();
+            images[i] = render_image(terrain, shaders, RenderPath::indirect);
+            vertices[i] = terrain.arena_stats().used;
+        }
+
+        int cracks = 0;
+        for (size_t i = 0; i < images[0].size(); i += 4) {
+            bool full_background = images[0][i] + images[0][i + 1] + images[0][i + 2]
+                == 3 * 255;
+            bool lod_background = images[1][i] + images[1][i + 1] + images[1][i + 2]
+                == 3 * 255;
+            cracks += lod_background && !full_background;
+        }
+        log("lod: {} chunks, {} vertices at full resolution, {} with lod, "
+            "{} pixels of background showing through",
+            side * side, vertices[0], vertices[1], cracks);
+        if (cracks > 0)
+            result = Result("{} pixels of background show through the lod seams", cracks);
+    }
+
+    log("rendering: cpu submit time per frame");
+    for (int radius : { 4, 8, 16 }) {
+        int side = radius * 2 + 1;
+        ResidencySettings settings = { .load_radius = radius,
+            .unload_radius = radius + 1,
+            .max_loaded = side * side,
+            .cache_capacity = 0 };
+        Terrain terrain(settings);
+        terrain.load_more_chunks(0, 0);
+        terrain.wait_until_loaded();
+
+        // both paths have to draw the same image
+        if (radius == 4) {
+            std::vector<uint8_t> per_chunk
+                = render_image(terrain, shaders, RenderPath::per_chunk);
+            std::vector<uint8_t> indirect
+                = render_image(terrain, shaders, RenderPath::indirect);
+            // the background is white
+            int drawn = 0;
+            for (size_t i = 0; i < indirect.size(); i += 4)
+                drawn += indirect[i] + indirect[i + 1] + indirect[i + 2] < 3 * 255;
+            log("  the paths' images {}, {} pixels drawn",
+                per_chunk == indirect ? "match" : "differ", drawn);
+            if (per_chunk != indirect)
+                result = Result("The per chunk and indirect paths' images differ");
+        }
+
+        // shrink the world into clip space so every chunk passes the frustum
+        // check and the gpu has next to nothing to rasterize
+        Matrix4 view_projection;
+        view_projection.m[0] = view_projection.m[5] = view_projection.m[10] = 1e-4;
+        shaders.set_frame(view_projection, Matrix4(), Vec3(0, 0, 0));
+
+        for (RenderPath path : { RenderPath::per_chunk, RenderPath::indirect }) {
+            terrain.set_render_path(path);
+            const int frames = 100;
+            double ns = 0;
+            for (int frame = 0; frame < frames; frame++) {
+                ns += time_ns(1, [&]() { terrain.render(Frustum(view_projection)); });
+                // keep the gpu from falling behind and blocking the next submit
+                glFinish();
+            }
+
+            log("  {} chunks, {}: {:.1f} us/frame", terrain.render_stats().drawn,
+                render_path_name(path), ns / frames / 1000.0);
+        }
+    }
+    return result;
+}
+
+Result run_benchmarks()
+{
+    benchmark_storage();
+    Result noise = benchmark_noise();
+    benchmark_generation();
+    benchmark_regions();
+    benchmark_codec();
+    benchmark_meshing();
+    benchmark_edits();
+    benchmark_bulk_edits();
+    benchmark_jobs();
+    return noise;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "utils.h"
+
+// Microbenchmarks for the engine's hot paths.
+// They run without a window and print their results, see `voxel --benchmark`.
+// Fails when a simd noise backend doesn't match the scalar one bit for bit
+Result run_benchmarks();
+
+// Shader load times with and without the program binary cache, and the CPU time
+// spent submitting a frame's draws with each render path as the number of chunks
+// grows. Needs a current GL context, see `voxel --benchmark-render`.
+// Fails when the render paths don't draw the same image, or when the background
+// shows through the seams between chunks at different levels of detail
+Result benchmark_rendering();
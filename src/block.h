@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+
+#include "math.h"
+
+// block ids stored in chunk voxel data, air is the absence of a block
+enum class Block : uint8_t { air, grass, dirt };
+const int NUM_BLOCKS = 3;
+
+// number of layers in the block texture array
+const int BLOCK_TEXTURES = 3;
+
+// texture array layer used for a face of a block
+// face is the direction the face is pointing in
+inline int block_texture(Block block, const IVec3& face)
+{
+    const int grass_side = 0, grass_top = 1, dirt = 2;
+    if (block == Block::grass)
+        return face.y > 0 ? grass_top : face.y < 0 ? dirt : grass_side;
+    return dirt;
+}
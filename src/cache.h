@@ -0,0 +1,45 @@
+#pragma once
+
+#include <list>
+#include <optional>
+#include <unordered_map>
+
+// A fixed capacity cache that drops its least recently used entry when full
+template <typename Key, typename Value, typename Hash> class LruCache {
+public:
+    LruCache(size_t capacity) : m_capacity(capacity) { }
+
+    void put(const Key& key, Value value)
+    {
+        take(key);
+        m_entries.push_front({ key, std::move(value) });
+        m_lookup[key] = m_entries.begin();
+
+        if (m_entries.size() > m_capacity) {
+            m_lookup.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+    }
+
+    // remove an entry from the cache and return it
+    std::optional<Value> take(const Key& key)
+    {
+        auto it = m_lookup.find(key);
+        if (it == m_lookup.end())
+            return std::nullopt;
+
+        Value value = std::move(it->second->second);
+        m_entries.erase(it->second);
+        m_lookup.erase(it);
+        return value;
+    }
+
+    size_t size() const { return m_entries.size(); }
+
+private:
+    size_t m_capacity;
+    // most recently used first
+    std::list<std::pair<Key, Value>> m_entries;
+    std::unordered_map<Key, typename std::list<std::pair<Key, Value>>::iterator, Hash>
+        m_lookup;
+};
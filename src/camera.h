@@ -80,3 +80,52 @@ private:
     Quaternion m_rotation;
     bool m_first_move;
 };
+
+struct Plane {
+    Vec3 normal;
+    float d;
+
+    // positive in front of the plane, negative behind it
+    float distance(const Vec3& p) const { return Vec3::dot(normal, p) + d; }
+};
+
+// The planes of a view frustum, pointing inwards
+struct Frustum {
+    // extract the planes from a projection * view matrix
+    // (Gribb & Hartmann, "Fast Extraction of Viewing Frustum Planes")
+    Frustum(const Matrix4& matrix)
+    {
+        // each plane is the matrix's last row plus or minus one of the other
+        // rows, row r of the column-major matrix is m[r], m[4 + r], m[8 + r], m[12 + r]
+        const float* m = matrix.m;
+        auto plane = [&](int r, float sign) {
+            Vec3 normal(
+                m[3] + sign * m[r], m[7] + sign * m[4 + r], m[11] + sign * m[8 + r]);
+            float d = m[15] + sign * m[12 + r];
+            float length = normal.length();
+            return Plane { .normal = normal * (1.0f / length), .d = d / length };
+        };
+
+        planes[0] = plane(0, 1); // left
+        planes[1] = plane(0, -1); // right
+        planes[2] = plane(1, 1); // bottom
+        planes[3] = plane(1, -1); // top
+        planes[4] = plane(2, 1); // near
+        planes[5] = plane(2, -1); // far
+    }
+
+    // check if an axis aligned box is at least partially inside the frustum
+    bool intersects(const Vec3& min, const Vec3& max) const
+    {
+        for (const Plane& plane : planes) {
+            // the corner of the box furthest along the plane's normal
+            Vec3 corner(plane.normal.x > 0 ? max.x : min.x,
+                plane.normal.y > 0 ? max.y : min.y, plane.normal.z > 0 ? max.z : min.z);
+            if (plane.distance(corner) < 0)
+                return false;
+        }
+        return true;
+    }
+
+    Plane planes[6];
+};
@@ -1,172 +1,73 @@
-#include <glad/glad.h>
+#include <algorithm>
 
 #include "chunk.h"
+#include "mesher.h"
 
-inline float fade(float t) { return t * t * t * (t * (t * 6 - 15) + 10); }
-
-Vec2 gradient(int x, int y)
+Chunk::Chunk(IVec3 position, VoxelStorage voxels, VertexArena& arena)
+    : m_arena(arena),
+      m_voxels(std::move(voxels))
 {
-    // tileable and continuous perlin noise
-    constexpr int noise_period = 512;
-    int px = (x % noise_period + noise_period) % noise_period;
-    int py = (y % noise_period + noise_period) % noise_period;
-
-    // xxHash
-    int h = px * 3266489917 + py * 668265263;
-    h ^= h >> 15;
-    h *= 2246822519;
-    h ^= h >> 13;
-    h *= 3266489917;
-    h ^= h >> 16;
-    // random gradient vector
-    Vec2 directions[] = { Vec2 { 1, 0 }, Vec2 { -1, 0 }, Vec2 { 0, 1 }, Vec2 { 0, -1 },
-        Vec2 { 1, 1 }, Vec2 { -1, 1 }, Vec2 { 1, -1 }, Vec2 { -1, -1 } };
-    return directions[h & 7];
+    m_position = position * IVec3(CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE);
+    m_num_quads = 0;
+    m_lod = 0;
+    m_last_used = 0;
+    m_unsaved = false;
+    m_mesh = VertexArena::NONE;
 }
 
-float perlin_noise(float x, float y)
-{
-    // get the grid cell the point's in and
-    // the direction of the point in that grid cell
-    int X = std::floor(x);
-    int Y = std::floor(y);
-    float dx = x - X;
-    float dy = y - Y;
-
-    // get the gradient vectors for each corner
-    Vec2 gtl = gradient(X, Y);
-    Vec2 gtr = gradient(X + 1, Y);
-    Vec2 gbl = gradient(X, Y + 1);
-    Vec2 gbr = gradient(X + 1, Y + 1);
-
-    // compute dot products to get the gradient values for each corner
-    float vtl = gtl.x * dx + gtl.y * dy;
-    float vtr = gtr.x * (dx - 1) + gtr.y * dy;
-    float vbl = gbl.x * dx + gbl.y * (dy - 1);
-    float vbr = gbr.x * (dx - 1) + gbr.y * (dy - 1);
-
-    // interpolate those values
-    float a = std::lerp(vtl, vtr, fade(dx));
-    float b = std::lerp(vbl, vbr, fade(dx));
-    float noise = std::lerp(a, b, fade(dy));
+Chunk::~Chunk() { m_arena.free(m_mesh); }
 
-    // normalize to a range of 0 to 1
-    return noise * 0.7f + 0.5f;
-}
-
-Chunk::Chunk(Vec3 position)
+void Chunk::draw(DrawList& draws) const
 {
-    // procedurally generate the chunk
-    const float frequency = 0.03; // the smaller the frequency, the smoother the noise
-    m_position = position * Vec3(CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE);
-
-    for (int x = 0; x < CHUNK_SIZE; x++) {
-        for (int z = 0; z < CHUNK_SIZE; z++) {
-            float random_x = (m_position.x + x) * frequency;
-            float random_z = (m_position.z + z) * frequency;
-            float noise = perlin_noise(random_x, random_z);
-            noise = fmin(fmax(noise, 0.1), 1.0);
-            // construct chunk bottom up
-            int y = floor(noise * CHUNK_HEIGHT);
-            for (int depth = 0; depth < y; depth++)
-                m_voxels.insert({ Vec3(x, depth, z), true });
-        }
-    }
-
-    compute_mesh();
-    init_buffers();
+    // mesh vertices are relative to the chunk's origin
+    if (m_mesh != VertexArena::NONE)
+        draws.add(m_arena.offset(m_mesh), m_num_quads, Vec3(m_position));
 }
 
-Chunk::~Chunk()
+void Chunk::upload_mesh(const Mesh& mesh)
 {
-    glDeleteBuffers(1, &m_vbo);
-    glDeleteBuffers(1, &m_ebo);
-    glDeleteVertexArrays(1, &m_vao);
+    m_arena.free(m_mesh);
+    m_mesh = m_arena.allocate(mesh.vertices);
+    m_num_quads = mesh.vertices.size() / 4;
 }
 
-void Chunk::render()
+bool Chunk::voxel_present(IVec3 position)
 {
-    glBindVertexArray(m_vao);
-    glDrawElements(GL_TRIANGLES, m_num_indices, GL_UNSIGNED_INT, 0);
+    return get_block(position.x, position.y, position.z) != Block::air;
 }
 
-void Chunk::init_buffers()
+Block Chunk::get_block(int x, int y, int z) const
 {
-    glGenVertexArrays(1, &m_vao);
-    glBindVertexArray(m_vao);
-
-    glGenBuffers(1, &m_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(Vertex), m_vertices.data(),
-        GL_STATIC_DRAW);
-
-    glGenBuffers(1, &m_ebo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_indices.size() * sizeof(unsigned int),
-        m_indices.data(), GL_STATIC_DRAW);
-
-    glVertexAttribPointer(
-        0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, vx));
-    glEnableVertexAttribArray(0); // position
-    glVertexAttribPointer(
-        1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
-    glEnableVertexAttribArray(1); // texture coordinate
-    glVertexAttribPointer(
-        2, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, wx));
-    glEnableVertexAttribArray(2); // voxel world position
-
-    m_num_indices = m_indices.size();
-    m_indices.clear();
-    m_vertices.clear();
+    return in_bounds(x, y, z) ? m_voxels.get(voxel_index(x, y, z)) : Block::air;
 }
 
-void Chunk::compute_mesh()
+void Chunk::set_block(int x, int y, int z, Block block)
 {
-    m_indices.clear();
-    m_vertices.clear();
-    auto voxel_faces = get_voxel_faces();
-    int quad_indices[] = { 0, 1, 2, 0, 2, 3 };
-
-    for (const auto& [p, _] : m_voxels) {
-        Vec3 abs_pos = m_position + p;
-
-        for (const auto& [face, vertices] : voxel_faces) {
-            // computing mesh bottom up
-            Vec3 face_position = Vec3(p.x + face.x, p.y + face.y, p.z + face.z);
-            // only add vertices for voxel faces that aren't occluded
-            if (!m_voxels.count(face_position)) {
-                unsigned int base_index = m_vertices.size();
-
-                for (const Vertex v : vertices) {
-                    m_vertices.push_back({ // clang-format off
-                        // apply translattion
-                         v.vx + abs_pos.x,
-                         v.vy + abs_pos.y,
-                         v.vz + abs_pos.z,
-                         v.u,
-                         v.v,
-                         // only use grass-side sprite for top layer voxels
-                         p.y != 0 && v.w == 0 ? 2 : v.w,
-                         abs_pos.x, abs_pos.y, abs_pos.z
-                    });
-                }
-
-                // indices for the quad
-                for (int i = 0; i < 6; i++) {
-                    m_indices.push_back(base_index + quad_indices[i]);
-                }
-            }
-        }
+    if (in_bounds(x, y, z)) {
+        m_voxels.set(voxel_index(x, y, z), block);
+        m_unsaved = true;
     }
 }
 
-bool Chunk::voxel_present(Vec3 position) { return m_voxels.count(position); }
+bool Chunk::fill_column(int x, int z, int y_begin, int y_end, Block block)
+{
+    y_begin = std::max(y_begin, 0);
+    y_end = std::min(y_end, CHUNK_HEIGHT);
+    if (!in_bounds(x, 0, z) || y_begin >= y_end)
+        return false;
+
+    // a column's voxels are contiguous, so the range is filled a word at a time
+    int begin = voxel_index(x, y_begin, z);
+    m_voxels.fill(begin, begin + y_end - y_begin, block);
+    m_unsaved = true;
+    return true;
+}
 
-float Chunk::get_surface_y(float x, float z)
+float Chunk::get_surface_y(int x, int z)
 {
     // find the y value of the top layer voxel
-    for (int y = CHUNK_HEIGHT; y >= 0; y--) {
-        if (m_voxels.count(Vec3(x, y, z)))
+    for (int y = CHUNK_HEIGHT - 1; y >= 0; y--) {
+        if (get_block(x, y, z) != Block::air)
             return y;
     }
     return CHUNK_HEIGHT;
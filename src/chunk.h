@@ -1,15 +1,25 @@
 #pragma once
 
-#include <vector>
-
+#include "arena.h"
+#include "draw.h"
+#include "storage.h"
 #include "vertex.h"
 
 const int CHUNK_SIZE = 20;
 const int CHUNK_HEIGHT = 20;
+const int CHUNK_VOLUME = CHUNK_SIZE * CHUNK_HEIGHT * CHUNK_SIZE;
+const int CHUNK_AREA = CHUNK_SIZE * CHUNK_SIZE; // columns in a chunk
+
+// offsets to the chunks that share a side with a chunk
+const IVec3 CHUNK_NEIGHBOURS[4]
+    = { IVec3(-1, 0, 0), IVec3(1, 0, 0), IVec3(0, 0, -1), IVec3(0, 0, 1) };
+
+struct Mesh;
 
 class Chunk {
 public:
-    Chunk(Vec3 position);
+    // the chunk's mesh is allocated from the arena, which has to outlive it
+    Chunk(IVec3 position, VoxelStorage voxels, VertexArena& arena);
     ~Chunk();
 
     // disable copy and move constructors
@@ -18,20 +28,64 @@ public:
     Chunk& operator=(Chunk&) = delete;
     Chunk(Chunk&) = delete;
 
-    void render();
-    bool voxel_present(Vec3 position);
-    float get_surface_y(float x, float z);
+    // queue the chunk's mesh to be drawn
+    void draw(DrawList& draws) const;
+    IVec3 position() const { return m_position; }
+    // the world space box the chunk's voxels are rendered in
+    Vec3 bounds_min() const { return Vec3(m_position) - Vec3(0.5, 0.5, 0.5); }
+    Vec3 bounds_max() const
+    {
+        return bounds_min() + Vec3(CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE);
+    }
+    // replace the chunk's mesh in the arena
+    void upload_mesh(const Mesh& mesh);
+    bool voxel_present(IVec3 position);
+    float get_surface_y(int x, int z);
 
-private:
-    void compute_mesh();
-    void init_buffers();
+    // voxel coordinates are local to the chunk,
+    // reading outside of the chunk returns air
+    Block get_block(int x, int y, int z) const;
+    void set_block(int x, int y, int z, Block block);
+    // set the blocks of a column from y_begin up to y_end, the part of the range
+    // outside of the chunk is ignored. Returns false when no voxels were in range
+    bool fill_column(int x, int z, int y_begin, int y_end, Block block);
+    const VoxelStorage& voxels() const { return m_voxels; }
+    VoxelStorage& voxels() { return m_voxels; }
+
+    // the last frame the chunk was near the player,
+    // the least recently used chunks are unloaded first
+    unsigned int last_used() const { return m_last_used; }
+    void mark_used(unsigned int frame) { m_last_used = frame; }
 
-    int m_num_indices;
-    unsigned int m_vao, m_vbo, m_ebo;
-    // cleared after the chunk is generated
-    std::vector<unsigned int> m_indices;
-    std::vector<Vertex> m_vertices;
+    // the level of detail the chunk is meshed at, see MeshVolume
+    int lod() const { return m_lod; }
+    void set_lod(int lod) { m_lod = lod; }
+
+    // true when the voxels have changed since the chunk was last saved
+    bool unsaved() const { return m_unsaved; }
+    void set_unsaved(bool unsaved) { m_unsaved = unsaved; }
+
+    static bool in_bounds(int x, int y, int z)
+    {
+        return x >= 0 && x < CHUNK_SIZE && y >= 0 && y < CHUNK_HEIGHT && z >= 0
+            && z < CHUNK_SIZE;
+    }
+
+    // voxels are stored column by column so that a column's
+    // blocks are contiguous in memory, bottom to top
+    static int voxel_index(int x, int y, int z)
+    {
+        return (x * CHUNK_SIZE + z) * CHUNK_HEIGHT + y;
+    }
+
+private:
+    int m_num_quads;
+    int m_lod;
+    unsigned int m_last_used;
+    bool m_unsaved;
+    VertexArena& m_arena;
+    VertexArena::Handle m_mesh;
 
-    Vec3 m_position;
-    std::unordered_map<Vec3, bool, Vec3Hasher> m_voxels;
+    IVec3 m_position; // world position of the chunk's origin
+    VoxelStorage m_voxels;
 };
@@ -0,0 +1,197 @@
+#include <algorithm>
+#include <cstring>
+
+#include "codec.h"
+
+// LZ77 in the style of LZ4. The stream is a list of sequences: a token byte holding
+// the literal count and the match length in its high and low 4 bits, the literal
+// bytes, then a 2 byte offset back into the output that the match is copied from.
+// Counts that don't fit in 4 bits continue in extra bytes until one isn't 255.
+// The last sequence is only literals.
+const int MIN_MATCH = 4;
+const int MAX_OFFSET = 65535;
+const int HASH_BITS = 12;
+
+// the largest the column runs can be, one run per voxel
+const size_t MAX_COLUMNS_SIZE = CHUNK_VOLUME * 2;
+
+inline uint32_t read32(const uint8_t* p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    return value;
+}
+
+inline void write_count(std::vector<uint8_t>& out, size_t count)
+{
+    for (; count >= 255; count -= 255)
+        out.push_back(255);
+    out.push_back(count);
+}
+
+inline bool read_count(const uint8_t* data, size_t size, size_t& i, size_t& count)
+{
+    while (true) {
+        if (i >= size)
+            return false;
+        uint8_t byte = data[i++];
+        count += byte;
+        if (byte != 255)
+            return true;
+    }
+}
+
+void write_sequence(std::vector<uint8_t>& out, const uint8_t* literals,
+    size_t literal_count, size_t offset, size_t match_length)
+{
+    size_t match = match_length >= MIN_MATCH ? match_length - MIN_MATCH : 0;
+    out.push_back(
+        (std::min<size_t>(literal_count, 15) << 4) | std::min<size_t>(match, 15));
+    if (literal_count >= 15)
+        write_count(out, literal_count - 15);
+    out.insert(out.end(), literals, literals + literal_count);
+
+    if (match_length == 0)
+        return; // the last sequence
+    out.push_back(offset & 0xff);
+    out.push_back(offset >> 8);
+    if (match >= 15)
+        write_count(out, match - 15);
+}
+
+std::vector<uint8_t> lz_compress(const uint8_t* data, size_t size)
+{
+    // the last position each 4 byte sequence was seen at
+    int table[1 << HASH_BITS];
+    std::fill(std::begin(table), std::end(table), -1);
+
+    std::vector<uint8_t> out;
+    size_t anchor = 0, i = 0;
+    while (i + MIN_MATCH <= size) {
+        uint32_t sequence = read32(data + i);
+        uint32_t hash = (sequence * 2654435761u) >> (32 - HASH_BITS);
+        int candidate = table[hash];
+        table[hash] = i;
+
+        if (candidate < 0 || i - candidate > size_t(MAX_OFFSET)
+            || read32(data + candidate) != sequence) {
+            i++;
+            continue;
+        }
+
+        size_t length = MIN_MATCH;
+        while (i + length < size && data[candidate + length] == data[i + length])
+            length++;
+        write_sequence(out, data + anchor, i - anchor, i - candidate, length);
+        i += length;
+        anchor = i;
+    }
+
+    write_sequence(out, data + anchor, size - anchor, 0, 0);
+    return out;
+}
+
+Result lz_decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out)
+{
+    out.clear();
+    size_t i = 0;
+    while (i < size) {
+        uint8_t token = data[i++];
+        size_t literals = token >> 4;
+        if (literals == 15 && !read_count(data, size, i, literals))
+            return Result("Truncated compressed data");
+        if (i + literals > size || out.size() + literals > MAX_COLUMNS_SIZE)
+            return Result("Corrupt compressed data");
+        out.insert(out.end(), data + i, data + i + literals);
+        i += literals;
+        if (i == size)
+            break; // the last sequence
+
+        if (i + 2 > size)
+            return Result("Truncated compressed data");
+        size_t offset = data[i] | (data[i + 1] << 8);
+        i += 2;
+        size_t length = token & 15;
+        if (length == 15 && !read_count(data, size, i, length))
+            return Result("Truncated compressed data");
+        length += MIN_MATCH;
+        if (offset == 0 || offset > out.size()
+            || out.size() + length > MAX_COLUMNS_SIZE)
+            return Result("Corrupt compressed data");
+
+        // byte by byte since a match can overlap the bytes it's copying
+        size_t from = out.size() - offset;
+        for (size_t j = 0; j < length; j++)
+            out.push_back(out[from + j]);
+    }
+    return Result();
+}
+
+// runs are (block, length) byte pairs that never cross into the next column
+std::vector<uint8_t> encode_columns(const VoxelStorage& voxels)
+{
+    Block blocks[CHUNK_VOLUME];
+    voxels.unpack(blocks);
+
+    std::vector<uint8_t> out;
+    for (int column = 0; column < CHUNK_AREA; column++) {
+        const Block* voxel = blocks + column * CHUNK_HEIGHT;
+        for (int y = 0; y < CHUNK_HEIGHT;) {
+            int run = 1;
+            while (y + run < CHUNK_HEIGHT && voxel[y + run] == voxel[y])
+                run++;
+            out.push_back(uint8_t(voxel[y]));
+            out.push_back(run);
+            y += run;
+        }
+    }
+    return out;
+}
+
+Result decode_columns(const uint8_t* data, size_t size, VoxelStorage& voxels)
+{
+    // collect the palette first so the storage is only sized once
+    std::vector<Block> palette;
+    for (size_t i = 0; i + 1 < size; i += 2) {
+        Block block = Block(data[i]);
+        if (std::find(palette.begin(), palette.end(), block) == palette.end())
+            palette.push_back(block);
+    }
+    if (palette.empty() || size % 2 != 0)
+        return Result("Corrupt chunk columns");
+    voxels.fill(palette);
+
+    // runs of the same block in neighbouring columns are filled together
+    int count = 0, fill_begin = 0;
+    for (size_t i = 0; i < size; i += 2) {
+        int run = data[i + 1];
+        int column_end = (count / CHUNK_HEIGHT + 1) * CHUNK_HEIGHT;
+        if (data[i] >= NUM_BLOCKS || run == 0 || count + run > column_end)
+            return Result("Corrupt chunk columns");
+        count += run;
+        if (i + 2 >= size || data[i + 2] != data[i]) {
+            voxels.fill(fill_begin, count, Block(data[i]));
+            fill_begin = count;
+        }
+    }
+
+    if (count != CHUNK_VOLUME)
+        return Result("Corrupt chunk columns");
+    return Result();
+}
+
+std::vector<uint8_t> compress_chunk(const VoxelStorage& voxels)
+{
+    std::vector<uint8_t> columns = encode_columns(voxels);
+    return lz_compress(columns.data(), columns.size());
+}
+
+Result decompress_chunk(const uint8_t* data, size_t size, VoxelStorage& voxels)
+{
+    std::vector<uint8_t> columns;
+    columns.reserve(MAX_COLUMNS_SIZE);
+    Result result = lz_decompress(data, size, columns);
+    if (result.is_err())
+        return result;
+    return decode_columns(columns.data(), columns.size(), voxels);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+#include "chunk.h"
+#include "utils.h"
+
+// Chunk compression, used for save files and for the cache of unloaded chunks.
+// Each column is run length encoded bottom to top, which turns the solid ground,
+// surface and air of a column into a handful of runs. Neighbouring columns tend to
+// have the same runs, so the run stream is then compressed with an LZ77 stage
+// that replaces repeated byte sequences with back references.
+std::vector<uint8_t> compress_chunk(const VoxelStorage& voxels);
+Result decompress_chunk(const uint8_t* data, size_t size, VoxelStorage& voxels);
+
+// the stages on their own, for benchmarking
+std::vector<uint8_t> encode_columns(const VoxelStorage& voxels);
+Result decode_columns(const uint8_t* data, size_t size, VoxelStorage& voxels);
+std::vector<uint8_t> lz_compress(const uint8_t* data, size_t size);
+Result lz_decompress(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include "determinism.h"
+#include "generator.h"
+#include "jobs.h"
+
+// the region is (2 * radius + 1)^2 chunks around the origin
+const int REGION_RADIUS = 8;
+
+uint64_t hash_voxels(const VoxelStorage& voxels)
+{
+    Fnv1a fnv;
+    for (int i = 0; i < voxels.size(); i++)
+        fnv.add(uint64_t(voxels.get(i)), 1);
+    return fnv.hash;
+}
+
+// generate every chunk in the region on a pool of workers, submitting them in a
+// random order, and return the hashes of the chunks in position order
+std::vector<uint64_t> generate_region(
+    const TerrainGenerator& generator, int threads, uint32_t order_seed)
+{
+    std::vector<IVec3> positions;
+    for (int x = -REGION_RADIUS; x <= REGION_RADIUS; x++) {
+        for (int z = -REGION_RADIUS; z <= REGION_RADIUS; z++)
+            positions.push_back(IVec3(x, 0, z));
+    }
+
+    std::vector<int> order(positions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), std::mt19937(order_seed));
+
+    std::vector<uint64_t> hashes(positions.size());
+    JobPool pool(threads);
+    for (int i : order) {
+        pool.submit(make_cancel_token(), [&, i]() {
+            VoxelStorage voxels(CHUNK_VOLUME);
+            generator.generate(positions[i], voxels);
+            hashes[i] = hash_voxels(voxels);
+        });
+    }
+    pool.wait();
+    return hashes;
+}
+
+uint64_t hash_region(const std::vector<uint64_t>& chunk_hashes)
+{
+    Fnv1a fnv;
+    for (uint64_t hash : chunk_hashes)
+        fnv.add(hash, 8);
+    return fnv.hash;
+}
+
+Result check_determinism(uint32_t seed, std::optional<uint64_t> expected)
+{
+    struct Run {
+        int threads;
+        NoiseBackend backend;
+    };
+
+    // the same configuration runs twice, with a different generation order each run
+    int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<Run> runs = { { 1, noise_backend() }, { 2, noise_backend() },
+        { max_threads, noise_backend() }, { max_threads, noise_backend() } };
+    // the slower backends the cpu supports have to agree with the fastest one
+    for (NoiseBackend backend : { NoiseBackend::scalar, NoiseBackend::sse41 }) {
+        if (backend < noise_backend())
+            runs.push_back({ max_threads, backend });
+    }
+
+    int side = REGION_RADIUS * 2 + 1;
+    log("determinism: seed {}, {}x{} chunks", seed, side, side);
+
+    std::vector<uint64_t> reference;
+    for (size_t i = 0; i < runs.size(); i++) {
+        TerrainGenerator generator(seed);
+        generator.set_noise_backend(runs[i].backend);
+        std::vector<uint64_t> hashes = generate_region(generator, runs[i].threads, i);
+
+        int mismatched = 0;
+        if (reference.empty())
+            reference = hashes;
+        for (size_t chunk = 0; chunk < hashes.size(); chunk++)
+            mismatched += hashes[chunk] != reference[chunk];
+
+        log("  {} threads, {} noise: region hash {:016x}, {} chunks differ",
+            runs[i].threads, noise_backend_name(runs[i].backend), hash_region(hashes),
+            mismatched);
+        if (mismatched > 0)
+            return Result("Generation isn't deterministic, {} chunks differ", mismatched);
+    }
+
+    uint64_t region = hash_region(reference);
+    if (expected.has_value() && *expected != region)
+        return Result("Region hash {:016x} doesn't match the expected {:016x}", region,
+            *expected);
+    return Result();
+}
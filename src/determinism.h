@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+
+#include "utils.h"
+
+// Generate a region of chunks several times, with different thread counts,
+// generation orders and noise backends, and check that every run produces the same
+// voxels. The region's hash is logged so that it can be compared across builds and
+// machines, and if an expected hash is given the region has to match it
+Result check_determinism(uint32_t seed, std::optional<uint64_t> expected = std::nullopt);
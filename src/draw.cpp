@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <glad/glad.h>
+
+#include "arena.h"
+#include "draw.h"
+
+// the vertex shader's ChunkOffsets block
+const int CHUNK_OFFSETS_BINDING = 0;
+
+DrawList::DrawList()
+{
+    glGenBuffers(1, &m_command_buffer);
+    glGenBuffers(1, &m_offset_buffer);
+}
+
+DrawList::~DrawList()
+{
+    glDeleteBuffers(1, &m_command_buffer);
+    glDeleteBuffers(1, &m_offset_buffer);
+}
+
+void DrawList::clear()
+{
+    m_commands.clear();
+    m_offsets.clear();
+}
+
+void DrawList::add(int first_vertex, int quads, Vec3 chunk_offset)
+{
+    const int max_quads = QuadIndexBuffer::MAX_QUADS;
+    for (int first = 0; first < quads; first += max_quads) {
+        m_commands.push_back({ .count = uint32_t(std::min(quads - first, max_quads) * 6),
+            .instance_count = 1,
+            .first_index = 0,
+            .base_vertex = first_vertex + first * 4,
+            .base_instance = uint32_t(m_commands.size()) });
+        m_offsets.insert(
+            m_offsets.end(), { chunk_offset.x, chunk_offset.y, chunk_offset.z, 0 });
+    }
+}
+
+void DrawList::submit(RenderPath path)
+{
+    if (m_commands.empty())
+        return;
+
+    // the buffers are respecified every frame so the driver can hand out fresh
+    // storage instead of waiting for the last frame's draws to finish with it
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_offset_buffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_offsets.size() * sizeof(float),
+        m_offsets.data(), GL_STREAM_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CHUNK_OFFSETS_BINDING, m_offset_buffer);
+
+    if (path == RenderPath::per_chunk) {
+        for (const DrawElementsIndirectCommand& command : m_commands) {
+            glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count,
+                GL_UNSIGNED_SHORT, nullptr, 1, command.base_vertex,
+                command.base_instance);
+        }
+        return;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_command_buffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER,
+        m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data(),
+        GL_STREAM_DRAW);
+    glMultiDrawElementsIndirect(
+        GL_TRIANGLES, GL_UNSIGNED_SHORT, nullptr, m_commands.size(), 0);
+}
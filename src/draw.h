@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "math.h"
+
+// the layout glMultiDrawElementsIndirect reads its commands in
+struct DrawElementsIndirectCommand {
+    uint32_t count;
+    uint32_t instance_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t base_instance;
+};
+
+// indirect draws every chunk with one glMultiDrawElementsIndirect call,
+// per_chunk issues a draw call for each chunk and is kept for comparison
+enum class RenderPath { per_chunk, indirect };
+
+inline const char* render_path_name(RenderPath path)
+{
+    return path == RenderPath::indirect ? "indirect" : "per chunk";
+}
+
+// The draws for the chunks visible in a frame, all from the vertex arena.
+// Every draw gets an entry in a shader storage buffer of chunk offsets, and its
+// base instance is the entry's index, so the vertex shader finds its chunk's
+// offset with gl_BaseInstance whichever path drew it.
+class DrawList {
+public:
+    DrawList();
+    ~DrawList();
+
+    // disable copy and move constructors
+    DrawList& operator=(const DrawList&) = delete;
+    DrawList(const DrawList&) = delete;
+
+    void clear();
+    // queue a mesh starting at a vertex in the arena, meshes with more quads
+    // than the 16 bit quad indices can address are split into several draws
+    void add(int first_vertex, int quads, Vec3 chunk_offset);
+    // upload the commands and offsets and draw them,
+    // the arena's vertex array has to be bound
+    void submit(RenderPath path);
+
+    int size() const { return m_commands.size(); }
+
+private:
+    std::vector<DrawElementsIndirectCommand> m_commands;
+    std::vector<float> m_offsets; // a vec4 per draw, std430 pads vec3s to 16 bytes
+    unsigned int m_command_buffer, m_offset_buffer;
+};
@@ -2,24 +2,36 @@
 
 #include "engine.h"
 
-Engine::Engine(float window_width, float window_height)
+// in chunks, far away chunks are meshed at a lower level of detail
+const int VIEW_RADIUS = 6;
+// past the corners of the loaded chunks
+const float FAR_PLANE = VIEW_RADIUS * CHUNK_SIZE * 1.5f;
+
+Engine::Engine(float window_width, float window_height, uint32_t seed)
+    : m_terrain({ .load_radius = VIEW_RADIUS,
+                    .unload_radius = VIEW_RADIUS + 2,
+                    .max_loaded = (VIEW_RADIUS * 2 + 5) * (VIEW_RADIUS * 2 + 5) },
+          seed, std::format("saves/{}", seed))
 {
-    auto result
-        = m_shaders.load("assets/shaders/vertex.glsl", "assets/shaders/fragment.glsl");
+    auto result = m_shaders.load(
+        "assets/shaders/vertex.glsl", "assets/shaders/fragment.glsl", "cache/shaders");
     if (result.is_err())
         log(Level::fatal, result.error());
 
-    result = m_spritesheet.load("assets/textures/atlas.png", 64, 3);
+    result = m_spritesheet.load(
+        "assets/textures/atlas.png", 64, BLOCK_TEXTURES, "cache/textures");
     if (result.is_err())
         log(Level::fatal, result.error());
 
     glViewport(0, 0, window_width, window_height);
     m_projection = Matrix4::projection(
-        0.1f, 100.0f, 45 * (M_PI / 180.0f), window_width / window_height);
+        0.1f, FAR_PLANE, 45 * (M_PI / 180.0f), window_width / window_height);
     m_window_size = Vec2(window_width, window_height);
     m_camera_disabled = false;
 
+    // the player spawns on the terrain, so it has to exist first
     m_terrain.load_more_chunks(0, 0);
+    m_terrain.wait_until_loaded();
     m_player.init(&m_terrain);
 }
 
@@ -29,6 +41,8 @@ void Engine::handle_mouse_click(bool left_click)
 {
     if (left_click)
         m_player.place_object();
+    else
+        m_player.remove_object();
 }
 
 void Engine::handle_mouse_move(float x, float y)
@@ -37,11 +51,21 @@ void Engine::handle_mouse_move(float x, float y)
         m_player.rotate(x, y);
 }
 
+void Engine::toggle_mesh_mode()
+{
+    // cycle through naive -> greedy -> binary
+    MeshMode mode = m_terrain.mesh_mode() == MeshMode::naive ? MeshMode::greedy
+        : m_terrain.mesh_mode() == MeshMode::greedy          ? MeshMode::binary
+                                                             : MeshMode::naive;
+    m_terrain.set_mesh_mode(mode);
+    log("using the {} mesher", mesh_mode_name(mode));
+}
+
 void Engine::handle_resize(int width, int height)
 {
     glViewport(0, 0, width, height);
     float aspect = float(width) / float(height);
-    m_projection = Matrix4::projection(0.1, 100.0, 45 * (M_PI / 180), aspect);
+    m_projection = Matrix4::projection(0.1, FAR_PLANE, 45 * (M_PI / 180), aspect);
     m_window_size = Vec2(width, height);
 }
 
@@ -49,13 +73,13 @@ void Engine::render()
 {
     Vec3 p = m_player.position();
     m_terrain.load_more_chunks(p.x, p.z);
+    m_terrain.update();
     m_player.update();
 
+    Matrix4 view = m_player.view_matrix();
     m_shaders.use();
-    m_shaders.set_matrix4("projection", m_projection);
-    m_shaders.set_matrix4("view", m_player.view_matrix());
-    m_shaders.set_vec3("selected_world_pos", m_player.selected_object());
+    m_shaders.set_frame(m_projection, view, m_player.selected_object());
 
     m_spritesheet.bind(m_shaders, 0);
-    m_terrain.render();
+    m_terrain.render(Frustum(m_projection * view));
 }
@@ -5,7 +5,7 @@
 
 class Engine {
 public:
-    Engine(float window_width, float window_height);
+    Engine(float window_width, float window_height, uint32_t seed = 0);
 
     void render();
     void move_player(Direction direction);
@@ -13,7 +13,11 @@ public:
     void handle_resize(int width, int height);
     void handle_mouse_move(float x, float y);
     void handle_mouse_click(bool left_click);
+    void explode_selection() { m_player.explode_object(); }
     void disable_camera_movement() { m_camera_disabled = true; }
+    void toggle_mesh_mode();
+    RenderStats render_stats() const { return m_terrain.render_stats(); }
+    ArenaStats arena_stats() const { return m_terrain.arena_stats(); }
 
 private:
     void load_assets();
@@ -0,0 +1,202 @@
+#include <algorithm>
+
+#include "generator.h"
+
+// the smaller the frequency, the smoother the noise
+const int FBM_OCTAVES = 4;
+const float FBM_FREQUENCY = 0.02;
+const float FBM_LACUNARITY = 2.0; // frequency multiplier between octaves
+const float FBM_GAIN = 0.5; // amplitude multiplier between octaves
+const float BIOME_FREQUENCY = 0.006;
+
+// the terrain's height is its base height plus the elevation scaled by the biome
+const float BASE_HEIGHT = CHUNK_HEIGHT * 0.45f;
+const float FLAT_AMPLITUDE = 6.0f;
+const float HILLY_AMPLITUDE = 18.0f;
+
+// mix a seed with a salt so that every noise field gets its own seed
+inline uint32_t derive_seed(uint32_t seed, uint32_t salt)
+{
+    uint32_t h = seed * 2654435761u + salt * 2246822519u;
+    h ^= h >> 15;
+    h *= 3266489917u;
+    h ^= h >> 16;
+    return h;
+}
+
+inline float smoothstep(float edge0, float edge1, float x)
+{
+    float t = std::clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
+    return t * t * (3 - 2 * t);
+}
+
+// the number of solid blocks in a column
+inline int column_height(const ColumnFields& fields, int column)
+{
+    return std::clamp(int(std::floor(fields.height[column])), 1, CHUNK_HEIGHT);
+}
+
+const char* stage_name(GenerationStage stage)
+{
+    switch (stage) {
+    case GenerationStage::height:
+        return "height";
+    case GenerationStage::biome:
+        return "biome";
+    case GenerationStage::surface:
+        return "surface";
+    case GenerationStage::decoration:
+        return "decoration";
+    }
+    return "unknown";
+}
+
+ColumnFields::ColumnFields(IVec3 chunk_pos) : position(chunk_pos)
+{
+    for (int x = 0; x < CHUNK_SIZE; x++) {
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            int column = x * CHUNK_SIZE + z;
+            this->x[column] = chunk_pos.x * CHUNK_SIZE + x;
+            this->z[column] = chunk_pos.z * CHUNK_SIZE + z;
+        }
+    }
+
+    std::fill(std::begin(elevation), std::end(elevation), 0.5f);
+    std::fill(std::begin(humidity), std::end(humidity), 0.5f);
+    std::fill(std::begin(biome), std::end(biome), Biome::plains);
+    std::fill(std::begin(height), std::end(height), BASE_HEIGHT);
+}
+
+TerrainGenerator::TerrainGenerator(uint32_t seed, std::vector<GenerationStage> stages)
+    : m_seed(seed),
+      m_backend(noise_backend()),
+      m_stages(std::move(stages))
+{
+}
+
+void TerrainGenerator::generate(IVec3 chunk_pos, VoxelStorage& voxels) const
+{
+    ColumnFields fields(chunk_pos);
+    voxels.fill(Block::air);
+    for (GenerationStage stage : m_stages)
+        run_stage(stage, fields, voxels);
+}
+
+void TerrainGenerator::run_stage(
+    GenerationStage stage, ColumnFields& fields, VoxelStorage& voxels) const
+{
+    switch (stage) {
+    case GenerationStage::height:
+        fbm_height(fields);
+        break;
+    case GenerationStage::biome:
+        select_biomes(fields);
+        break;
+    case GenerationStage::surface:
+        layer_surface(fields, voxels);
+        break;
+    case GenerationStage::decoration:
+        decorate(fields, voxels);
+        break;
+    }
+}
+
+void TerrainGenerator::fbm_height(ColumnFields& fields) const
+{
+    float xs[CHUNK_AREA], zs[CHUNK_AREA], noise[CHUNK_AREA];
+    std::fill(std::begin(fields.elevation), std::end(fields.elevation), 0.0f);
+
+    float frequency = FBM_FREQUENCY, amplitude = 1.0f, total_amplitude = 0.0f;
+    for (int octave = 0; octave < FBM_OCTAVES; octave++) {
+        for (int i = 0; i < CHUNK_AREA; i++) {
+            xs[i] = fields.x[i] * frequency;
+            zs[i] = fields.z[i] * frequency;
+        }
+        perlin_noise(xs, zs, noise, CHUNK_AREA, derive_seed(m_seed, octave), m_backend);
+
+        for (int i = 0; i < CHUNK_AREA; i++)
+            fields.elevation[i] += noise[i] * amplitude;
+        total_amplitude += amplitude;
+        frequency *= FBM_LACUNARITY;
+        amplitude *= FBM_GAIN;
+    }
+
+    for (int i = 0; i < CHUNK_AREA; i++) {
+        fields.elevation[i] /= total_amplitude;
+        fields.height[i]
+            = BASE_HEIGHT + (fields.elevation[i] - 0.5f) * 2.0f * FLAT_AMPLITUDE;
+    }
+}
+
+void TerrainGenerator::select_biomes(ColumnFields& fields) const
+{
+    float xs[CHUNK_AREA], zs[CHUNK_AREA];
+    for (int i = 0; i < CHUNK_AREA; i++) {
+        xs[i] = fields.x[i] * BIOME_FREQUENCY;
+        zs[i] = fields.z[i] * BIOME_FREQUENCY;
+    }
+    perlin_noise(xs, zs, fields.humidity, CHUNK_AREA, derive_seed(m_seed, FBM_OCTAVES),
+        m_backend);
+
+    for (int i = 0; i < CHUNK_AREA; i++) {
+        float humidity = fields.humidity[i];
+        fields.biome[i] = humidity < 0.35f ? Biome::barren
+            : humidity < 0.6f              ? Biome::plains
+                                           : Biome::hills;
+
+        // blend the amplitude instead of switching it with the
+        // biome so that there are no cliffs at biome borders
+        float hilliness = smoothstep(0.5f, 0.75f, humidity);
+        float amplitude = FLAT_AMPLITUDE + (HILLY_AMPLITUDE - FLAT_AMPLITUDE) * hilliness;
+        fields.height[i] = BASE_HEIGHT + (fields.elevation[i] - 0.5f) * 2.0f * amplitude;
+    }
+}
+
+void TerrainGenerator::layer_surface(
+    const ColumnFields& fields, VoxelStorage& voxels) const
+{
+    for (int x = 0; x < CHUNK_SIZE; x++) {
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            int column = x * CHUNK_SIZE + z;
+            int height = column_height(fields, column);
+            // nothing grows in barren land
+            Block top
+                = fields.biome[column] == Biome::barren ? Block::dirt : Block::grass;
+
+            // construct the column bottom up
+            for (int y = 0; y < height; y++) {
+                Block block = y == height - 1 ? top : Block::dirt;
+                voxels.set(Chunk::voxel_index(x, y, z), block);
+            }
+        }
+    }
+}
+
+void TerrainGenerator::decorate(const ColumnFields& fields, VoxelStorage& voxels) const
+{
+    const uint32_t decoration_seed = derive_seed(m_seed, FBM_OCTAVES + 1);
+
+    for (int x = 0; x < CHUNK_SIZE; x++) {
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            int column = x * CHUNK_SIZE + z;
+            if (fields.biome[column] != Biome::plains)
+                continue;
+
+            // hash the world position so that bushes don't depend on the chunk
+            uint32_t h = derive_seed(derive_seed(decoration_seed, int(fields.x[column])),
+                int(fields.z[column]));
+            if (h % 64 != 0)
+                continue;
+
+            int ground = column_height(fields, column);
+            int size = 1 + (h >> 6) % 2;
+            if (ground + size > CHUNK_HEIGHT)
+                continue;
+
+            // the covered grass turns to dirt
+            voxels.set(Chunk::voxel_index(x, ground - 1, z), Block::dirt);
+            for (int y = ground; y < ground + size; y++)
+                voxels.set(Chunk::voxel_index(x, y, z), Block::grass);
+        }
+    }
+}
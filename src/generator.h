@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include "chunk.h"
+#include "noise.h"
+
+enum class Biome : uint8_t { barren, plains, hills };
+
+// The steps chunks are generated in, each one builds on the ones before it
+enum class GenerationStage { height, biome, surface, decoration };
+const char* stage_name(GenerationStage stage);
+
+// Noise and other fields of a chunk's columns, computed once per chunk and shared
+// between the stages. Columns are indexed by x * CHUNK_SIZE + z
+struct ColumnFields {
+    ColumnFields(IVec3 chunk_pos);
+
+    IVec3 position; // chunk position
+    float x[CHUNK_AREA], z[CHUNK_AREA]; // world position of each column
+    float elevation[CHUNK_AREA]; // fractal noise, roughly from 0 to 1
+    float humidity[CHUNK_AREA]; // biome noise, roughly from 0 to 1
+    Biome biome[CHUNK_AREA];
+    float height[CHUNK_AREA]; // height of the terrain in blocks
+};
+
+// Procedurally generates chunks by running a list of stages over them.
+// The voxels generated only depend on the seed and the chunk position, not on
+// the order chunks are generated in or the noise backend, and generating holds no
+// mutable state, so workers can share one generator
+class TerrainGenerator {
+public:
+    TerrainGenerator(uint32_t seed = 0,
+        std::vector<GenerationStage> stages = { GenerationStage::height,
+            GenerationStage::biome, GenerationStage::surface,
+            GenerationStage::decoration });
+
+    uint32_t seed() const { return m_seed; }
+    // every backend gives the same voxels, this is for checking that they do
+    void set_noise_backend(NoiseBackend backend) { m_backend = backend; }
+    const std::vector<GenerationStage>& stages() const { return m_stages; }
+
+    // generate the voxels of the chunk at a chunk position
+    void generate(IVec3 chunk_pos, VoxelStorage& voxels) const;
+    // run a single stage over a chunk, the stages before it should already have run
+    void run_stage(
+        GenerationStage stage, ColumnFields& fields, VoxelStorage& voxels) const;
+
+private:
+    // fractal brownian motion: octaves of noise with rising frequency and falling
+    // amplitude, giving large hills with smaller bumps on top of them
+    void fbm_height(ColumnFields& fields) const;
+    // pick a biome per column, blending the terrain's shape between biomes
+    void select_biomes(ColumnFields& fields) const;
+    // fill the columns up to their height with the biome's blocks
+    void layer_surface(const ColumnFields& fields, VoxelStorage& voxels) const;
+    // scatter small bushes over the plains
+    void decorate(const ColumnFields& fields, VoxelStorage& voxels) const;
+
+    uint32_t m_seed;
+    NoiseBackend m_backend;
+    std::vector<GenerationStage> m_stages;
+};
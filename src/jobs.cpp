@@ -0,0 +1,47 @@
+#include "jobs.h"
+
+JobPool::JobPool(int num_threads) : m_running(0)
+{
+    for (int i = 0; i < num_threads; i++)
+        m_workers.emplace_back([this](std::stop_token stop) { work(stop); });
+}
+
+void JobPool::submit(CancelToken token, std::function<void()> job)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_jobs.push_back({ .token = token, .run = std::move(job) });
+    }
+    m_job_added.notify_one();
+}
+
+void JobPool::wait()
+{
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [this]() { return m_jobs.empty() && m_running == 0; });
+}
+
+void JobPool::work(std::stop_token stop)
+{
+    while (true) {
+        Job job;
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_job_added.wait(lock, stop, [this]() { return !m_jobs.empty(); }))
+                return; // stop was requested
+
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_running++;
+        }
+
+        if (!cancelled(job.token))
+            job.run();
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_running--;
+        }
+        m_idle.notify_all();
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Shared between a job and whoever submitted it. Setting it
+// cancels the job if it hasn't started yet and tells the submitter to
+// discard the job's result if it has
+using CancelToken = std::shared_ptr<std::atomic<bool>>;
+
+inline CancelToken make_cancel_token() { return std::make_shared<std::atomic<bool>>(false); }
+
+inline void cancel(const CancelToken& token) { token->store(true); }
+
+inline bool cancelled(const CancelToken& token) { return token->load(); }
+
+// A pool of worker threads that run jobs in the order they're submitted
+class JobPool {
+public:
+    JobPool(int num_threads);
+
+    // disable copy and move constructors
+    JobPool& operator=(const JobPool&) = delete;
+    JobPool(const JobPool&) = delete;
+
+    void submit(CancelToken token, std::function<void()> job);
+    // block until every submitted job has finished or been cancelled
+    void wait();
+    int num_threads() const { return m_workers.size(); }
+
+private:
+    struct Job {
+        CancelToken token;
+        std::function<void()> run;
+    };
+
+    void work(std::stop_token stop);
+
+    std::mutex m_mutex;
+    std::condition_variable_any m_job_added;
+    std::condition_variable m_idle;
+    std::deque<Job> m_jobs;
+    int m_running;
+    // declared last so the workers are joined before anything else is destroyed
+    std::vector<std::jthread> m_workers;
+};
@@ -1,8 +1,11 @@
 #define GLFW_INCLUDE_NONE
 #include <GLFW/glfw3.h>
 
+#include <charconv>
 #include <glad/glad.h>
 
+#include "benchmark.h"
+#include "determinism.h"
 #include "engine.h"
 
 void resize_callback(GLFWwindow* window, int width, int height)
@@ -20,7 +23,9 @@ void mouse_move_callback(GLFWwindow* window, double xpos, double ypos)
 void mouse_click_callback(GLFWwindow* window, int button, int action, int mods)
 {
     Engine* engine = static_cast<Engine*>(glfwGetWindowUserPointer(window));
-    if (action == GLFW_RELEASE)
+    // left click places a block and right click removes one
+    bool used = button == GLFW_MOUSE_BUTTON_LEFT || button == GLFW_MOUSE_BUTTON_RIGHT;
+    if (action == GLFW_RELEASE && used)
         engine->handle_mouse_click(button == GLFW_MOUSE_BUTTON_LEFT);
 }
 
@@ -41,6 +46,14 @@ void keybinding_callback(GLFWwindow* window, int key, int scancode, int action,
         else
             glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
+
+    // cycle through the meshers
+    if (key == GLFW_KEY_G && action == GLFW_RELEASE)
+        engine->toggle_mesh_mode();
+
+    // blow up the block the player's looking at
+    if (key == GLFW_KEY_X && action == GLFW_RELEASE)
+        engine->explode_selection();
 }
 
 void handle_keyboard_input(GLFWwindow* window, Engine& engine)
@@ -127,8 +140,64 @@ void debug_callback(GLenum source, GLenum type, unsigned int id, GLenum severity
     log(level, "{} {} {}", source_info, type_info, message);
 }
 
-int main()
+// parse a whole argument as a number, empty when it isn't one or doesn't fit
+template <typename T> std::optional<T> parse_number(const std::string& arg, int base = 10)
+{
+    T value;
+    auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), value, base);
+    if (error != std::errc() || end != arg.data() + arg.size())
+        return std::nullopt;
+    return value;
+}
+
+int main(int argc, char** argv)
 {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.size() > 0 && args[0] == "--benchmark") {
+        Result result = run_benchmarks();
+        if (result.is_err()) {
+            log(Level::error, result.error());
+            return 1;
+        }
+        return 0;
+    }
+
+    // --check-determinism [seed] [expected region hash]
+    if (args.size() > 0 && args[0] == "--check-determinism") {
+        std::optional<uint32_t> seed
+            = args.size() > 1 ? parse_number<uint32_t>(args[1]) : 0;
+        std::optional<uint64_t> expected;
+        if (args.size() > 2)
+            expected = parse_number<uint64_t>(args[2], 16);
+        if (!seed.has_value() || (args.size() > 2 && !expected.has_value())) {
+            log(Level::error,
+                "usage: voxel --check-determinism [seed] [region hash in hex]");
+            return 1;
+        }
+
+        Result result = check_determinism(*seed, expected);
+        if (result.is_err()) {
+            log(Level::error, result.error());
+            return 1;
+        }
+        return 0;
+    }
+
+    // --seed <seed>
+    uint32_t seed = 0;
+    if (args.size() > 0 && args[0] == "--seed") {
+        std::optional<uint32_t> parsed
+            = args.size() > 1 ? parse_number<uint32_t>(args[1]) : std::nullopt;
+        if (!parsed.has_value()) {
+            log(Level::error, "usage: voxel --seed <seed>");
+            return 1;
+        }
+        seed = *parsed;
+    }
+
+    // --benchmark-render, it needs a gl context but no visible window
+    bool benchmark_rendering_only = args.size() > 0 && args[0] == "--benchmark-render";
+
     if (!glfwInit())
         log(Level::fatal, "Failed to init GLFW");
 
@@ -136,6 +205,7 @@ int main()
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, benchmark_rendering_only ? GLFW_FALSE : GLFW_TRUE);
     GLFWwindow* window = glfwCreateWindow(width, height, "Voxel", NULL, NULL);
     if (!window)
         log(Level::fatal, "Failed to create window");
@@ -159,9 +229,20 @@ int main()
     glDebugMessageCallback(debug_callback, nullptr);
     glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
 
+    if (benchmark_rendering_only) {
+        Result result = benchmark_rendering();
+        glfwTerminate();
+        if (result.is_err()) {
+            log(Level::error, result.error());
+            return 1;
+        }
+        return 0;
+    }
+
     {
-        Engine engine(width, height);
+        Engine engine(width, height, seed);
         glfwSetWindowUserPointer(window, &engine);
+        double last_title_update = glfwGetTime();
 
         while (!glfwWindowShouldClose(window)) {
             glClearColor(0.5, 0.8, 1.0, 1.0);
@@ -170,6 +251,17 @@ int main()
             handle_keyboard_input(window, engine);
             engine.render();
 
+            // show the frustum culling and mesh memory stats once a second
+            if (glfwGetTime() - last_title_update > 1.0) {
+                RenderStats stats = engine.render_stats();
+                ArenaStats arena = engine.arena_stats();
+                std::string title = std::format(
+                    "Voxel - chunks drawn: {}, culled: {}/{}, mesh vertices: {}/{}",
+                    stats.drawn, stats.culled, stats.tested, arena.used, arena.capacity);
+                glfwSetWindowTitle(window, title.c_str());
+                last_title_update = glfwGetTime();
+            }
+
             glfwSwapBuffers(window);
             glfwPollEvents();
         }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <math.h>
 
@@ -9,9 +10,43 @@ struct Vec2 {
     float x, y;
 };
 
+// integer coordinates, used to key chunks and voxels
+struct IVec3 {
+    IVec3() : x(0), y(0), z(0) { }
+    IVec3(int a, int b, int c) : x(a), y(b), z(c) { }
+
+    bool operator==(const IVec3& v) const { return x == v.x && y == v.y && z == v.z; }
+
+    IVec3 operator+(const IVec3& v) const { return IVec3(x + v.x, y + v.y, z + v.z); }
+
+    IVec3 operator-(const IVec3& v) const { return IVec3(x - v.x, y - v.y, z - v.z); }
+
+    IVec3 operator*(const IVec3& v) const { return IVec3(x * v.x, y * v.y, z * v.z); }
+
+    int x, y, z;
+};
+
+struct IVec3Hasher {
+    std::size_t operator()(const IVec3& v) const
+    {
+        // give each axis its own xxHash prime so that permuted
+        // coordinates don't collide, then avalanche the bits
+        uint64_t h = uint64_t(uint32_t(v.x)) * 0x9E3779B185EBCA87ull;
+        h ^= uint64_t(uint32_t(v.y)) * 0xC2B2AE3D27D4EB4Full;
+        h ^= uint64_t(uint32_t(v.z)) * 0x165667B19E3779F9ull;
+        h ^= h >> 33;
+        h *= 0xC2B2AE3D27D4EB4Full;
+        h ^= h >> 29;
+        h *= 0x165667B19E3779F9ull;
+        h ^= h >> 32;
+        return h;
+    }
+};
+
 struct Vec3 {
     Vec3() : x(0), y(0), z(0) { }
     Vec3(float a, float b, float c) : x(a), y(b), z(c) { }
+    explicit Vec3(const IVec3& v) : x(v.x), y(v.y), z(v.z) { }
 
     bool operator==(const Vec3& v) const { return x == v.x && y == v.y && z == v.z; }
 
@@ -45,7 +80,8 @@ struct Vec3 {
 
     float length() const { return std::sqrt(x * x + y * y + z * z); }
 
-    Vec3 floor() const { return Vec3(std::floor(x), std::floor(y), std::floor(z)); }
+    // the integer coordinates of the voxel containing this point
+    IVec3 voxel() const { return IVec3(std::floor(x), std::floor(y), std::floor(z)); }
 
     Vec3 norm() const
     {
@@ -63,14 +99,6 @@ struct Vec3 {
     float x, y, z;
 };
 
-struct Vec3Hasher {
-    std::size_t operator()(const Vec3& v) const
-    {
-        using fh = std::hash<float>;
-        return fh()(fh()(v.x) ^ fh()(v.y) ^ fh()(v.z));
-    }
-};
-
 struct Quaternion {
     Quaternion() : x(0), y(0), z(0), w(0) { }
 
@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <bit>
+
+#include "mesher.h"
+
+MeshVolume::MeshVolume(const VoxelStorage& voxels,
+    const std::array<const VoxelStorage*, 4>& neighbours, int lod)
+    : m_lod(lod),
+      m_size((CHUNK_SIZE + (1 << lod) - 1) >> lod),
+      m_height((CHUNK_HEIGHT + (1 << lod) - 1) >> lod),
+      m_blocks((m_size + 2) * (m_size + 2) * (m_height + 2), Block::air)
+{
+    if (lod > 0) {
+        downsample(voxels);
+        return;
+    }
+
+    for (int x = 0; x < CHUNK_SIZE; x++) {
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            for (int y = 0; y < CHUNK_HEIGHT; y++)
+                m_blocks[index(x, y, z)] = voxels.get(Chunk::voxel_index(x, y, z));
+        }
+    }
+
+    // copy the neighbours' voxels that touch the chunk's sides
+    for (int i = 0; i < 4; i++) {
+        if (neighbours[i] == nullptr)
+            continue;
+        IVec3 offset = CHUNK_NEIGHBOURS[i];
+
+        for (int j = 0; j < CHUNK_SIZE; j++) {
+            // position in this chunk and the same voxel in the neighbour
+            int x = offset.x < 0 ? -1 : offset.x > 0 ? CHUNK_SIZE : j;
+            int z = offset.z < 0 ? -1 : offset.z > 0 ? CHUNK_SIZE : j;
+            int nx = x - offset.x * CHUNK_SIZE;
+            int nz = z - offset.z * CHUNK_SIZE;
+            for (int y = 0; y < CHUNK_HEIGHT; y++)
+                m_blocks[index(x, y, z)] = neighbours[i]->get(Chunk::voxel_index(nx, y, nz));
+        }
+    }
+}
+
+void MeshVolume::downsample(const VoxelStorage& voxels)
+{
+    Block blocks[CHUNK_VOLUME];
+    voxels.unpack(blocks);
+
+    // the y of the voxel each cell took its block from
+    std::vector<int> tops(m_blocks.size(), -1);
+    const int cell = 1 << m_lod;
+    for (int x = 0; x < CHUNK_SIZE; x++) {
+        for (int z = 0; z < CHUNK_SIZE; z++) {
+            const Block* column = blocks + Chunk::voxel_index(x, 0, z);
+            for (int cell_y = 0; cell_y < m_height; cell_y++) {
+                // the highest solid voxel of the column inside of the cell
+                int bottom = cell_y * cell;
+                int y = std::min(bottom + cell, CHUNK_HEIGHT) - 1;
+                while (y >= bottom && column[y] == Block::air)
+                    y--;
+
+                int i = index(x / cell, cell_y, z / cell);
+                if (y >= bottom && y > tops[i]) {
+                    tops[i] = y;
+                    m_blocks[i] = column[y];
+                }
+            }
+        }
+    }
+}
+
+void add_quad(Mesh& mesh, const std::array<Vertex, 4>& vertices)
+{
+    mesh.vertices.insert(mesh.vertices.end(), vertices.begin(), vertices.end());
+}
+
+void build_naive_mesh(const MeshVolume& volume, Mesh& mesh)
+{
+    for (int x = 0; x < volume.size(); x++) {
+        for (int z = 0; z < volume.size(); z++) {
+            for (int y = 0; y < volume.height(); y++) {
+                Block block = volume.get(x, y, z);
+                if (block == Block::air)
+                    continue;
+
+                for (int face = 0; face < 6; face++) {
+                    // only add vertices for voxel faces that aren't occluded
+                    IVec3 n = FACE_NORMALS[face];
+                    if (volume.get(x + n.x, y + n.y, z + n.z) != Block::air)
+                        continue;
+
+                    int texture = block_texture(block, n);
+                    std::array<Vertex, 4> quad;
+                    for (int i = 0; i < 4; i++)
+                        quad[i] = Vertex(IVec3(x, y, z) + FACE_CORNERS[face][i], face, texture);
+                    add_quad(mesh, quad);
+                }
+            }
+        }
+    }
+}
+
+// the axis a face points along and the two axes of the slices perpendicular to it,
+// the texture's u coordinate runs along u_axis and v along v_axis
+struct FaceAxes {
+    int axis, u_axis, v_axis;
+};
+
+inline FaceAxes face_axes(const IVec3& face)
+{
+    int axis = face.x != 0 ? 0 : face.y != 0 ? 1 : 2;
+    return { .axis = axis, .u_axis = axis == 0 ? 2 : 0, .v_axis = axis == 1 ? 2 : 1 };
+}
+
+// stretch a unit face's corners over a w by h quad of faces starting at (u, v) in a
+// slice, the vertex shader derives texture coordinates that repeat once per voxel
+void add_merged_quad(
+    Mesh& mesh, int face, int slice, int u, int v, int w, int h, int texture)
+{
+    FaceAxes axes = face_axes(FACE_NORMALS[face]);
+    std::array<Vertex, 4> quad;
+    for (int i = 0; i < 4; i++) {
+        int corner[] = { FACE_CORNERS[face][i].x, FACE_CORNERS[face][i].y,
+            FACE_CORNERS[face][i].z };
+        int position[3];
+        position[axes.axis] = slice + corner[axes.axis];
+        position[axes.u_axis] = u + corner[axes.u_axis] * w;
+        position[axes.v_axis] = v + corner[axes.v_axis] * h;
+        quad[i] = Vertex(IVec3(position[0], position[1], position[2]), face, texture);
+    }
+    add_quad(mesh, quad);
+}
+
+// Sweep each slice of the chunk perpendicular to a face direction and merge
+// the visible faces in the slice into the largest rectangles that share a texture
+void build_greedy_mesh(const MeshVolume& volume, Mesh& mesh)
+{
+    const int size[] = { volume.size(), volume.height(), volume.size() };
+
+    for (int face = 0; face < 6; face++) {
+        IVec3 n = FACE_NORMALS[face];
+        FaceAxes axes = face_axes(n);
+        int width = size[axes.u_axis], height = size[axes.v_axis];
+
+        // the texture of each visible face in the slice, offset by 1 so 0 is no face
+        std::vector<int> mask(width * height);
+
+        for (int slice = 0; slice < size[axes.axis]; slice++) {
+            for (int v = 0; v < height; v++) {
+                for (int u = 0; u < width; u++) {
+                    int p[3];
+                    p[axes.axis] = slice;
+                    p[axes.u_axis] = u;
+                    p[axes.v_axis] = v;
+
+                    Block block = volume.get(p[0], p[1], p[2]);
+                    Block neighbour = volume.get(p[0] + n.x, p[1] + n.y, p[2] + n.z);
+                    bool visible = block != Block::air && neighbour == Block::air;
+                    mask[v * width + u] = visible ? block_texture(block, n) + 1 : 0;
+                }
+            }
+
+            for (int v = 0; v < height; v++) {
+                for (int u = 0; u < width;) {
+                    int texture = mask[v * width + u];
+                    if (texture == 0) {
+                        u++;
+                        continue;
+                    }
+
+                    // grow the quad along u, then along v while every row matches
+                    int w = 1, h = 1;
+                    while (u + w < width && mask[v * width + u + w] == texture)
+                        w++;
+                    bool grow = true;
+                    while (grow && v + h < height) {
+                        for (int i = 0; i < w && grow; i++)
+                            grow = mask[(v + h) * width + u + i] == texture;
+                        if (grow)
+                            h++;
+                    }
+                    for (int j = 0; j < h; j++) {
+                        for (int i = 0; i < w; i++)
+                            mask[(v + j) * width + u + i] = 0;
+                    }
+
+                    add_merged_quad(mesh, face, slice, u, v, w, h, texture - 1);
+                    u += w;
+                }
+            }
+        }
+    }
+}
+
+// Greedy meshing on bitmasks.
+// Every line of voxels along each axis is stored as a 64 bit occupancy mask, so
+// the visible faces of a whole line are found at once by shifting the mask onto
+// its neighbours. Visible faces are then sorted into per slice, per texture row
+// masks that are merged into quads with bit scans instead of comparing faces.
+void build_binary_mesh(const MeshVolume& volume, Mesh& mesh)
+{
+    static_assert(CHUNK_SIZE + 2 <= 64 && CHUNK_HEIGHT + 2 <= 64);
+    static_assert(CHUNK_SIZE <= 32 && CHUNK_HEIGHT <= 32);
+    const int size[] = { volume.size(), volume.height(), volume.size() };
+
+    // bit i + 1 of a line is set when voxel i is solid, bits 0 and size + 1 hold
+    // the voxels on either side of the chunk. Lines are indexed by their
+    // position along the u and v axes given by face_axes
+    std::vector<uint64_t> lines[3];
+    lines[0].assign(size[1] * size[0], 0); // lines along x, indexed by y, z
+    lines[1].assign(size[0] * size[0], 0); // lines along y, indexed by z, x
+    lines[2].assign(size[1] * size[0], 0); // lines along z, indexed by y, x
+
+    // the border above and below the chunk is always air
+    for (int x = -1; x <= size[0]; x++) {
+        for (int z = -1; z <= size[0]; z++) {
+            bool inside_x = x >= 0 && x < size[0];
+            bool inside_z = z >= 0 && z < size[0];
+            if (!inside_x && !inside_z)
+                continue;
+
+            for (int y = 0; y < size[1]; y++) {
+                if (volume.get(x, y, z) == Block::air)
+                    continue;
+                if (inside_z)
+                    lines[0][y * size[0] + z] |= uint64_t(1) << (x + 1);
+                if (inside_x && inside_z)
+                    lines[1][z * size[0] + x] |= uint64_t(1) << (y + 1);
+                if (inside_x)
+                    lines[2][y * size[0] + x] |= uint64_t(1) << (z + 1);
+            }
+        }
+    }
+
+    for (int face = 0; face < 6; face++) {
+        IVec3 n = FACE_NORMALS[face];
+        FaceAxes axes = face_axes(n);
+        int width = size[axes.u_axis], height = size[axes.v_axis];
+        int depth = size[axes.axis];
+        bool positive = n.x + n.y + n.z > 0;
+
+        // rows of visible faces, one bit per face along u, for each slice and texture
+        std::vector<uint32_t> rows(depth * BLOCK_TEXTURES * height, 0);
+        auto row = [&](int slice, int texture, int v) -> uint32_t& {
+            return rows[(slice * BLOCK_TEXTURES + texture) * height + v];
+        };
+
+        for (int v = 0; v < height; v++) {
+            for (int u = 0; u < width; u++) {
+                // a face is visible when its voxel is solid and the next voxel is air
+                uint64_t line = lines[axes.axis][v * width + u];
+                uint64_t visible = positive ? line & ~(line >> 1) : line & ~(line << 1);
+                visible = (visible >> 1) & ((uint64_t(1) << depth) - 1);
+
+                while (visible != 0) {
+                    int p[3];
+                    p[axes.axis] = std::countr_zero(visible);
+                    p[axes.u_axis] = u;
+                    p[axes.v_axis] = v;
+                    visible &= visible - 1;
+
+                    Block block = volume.get(p[0], p[1], p[2]);
+                    int texture = block_texture(block, n);
+                    row(p[axes.axis], texture, v) |= uint32_t(1) << u;
+                }
+            }
+        }
+
+        for (int slice = 0; slice < depth; slice++) {
+            for (int texture = 0; texture < BLOCK_TEXTURES; texture++) {
+                for (int v = 0; v < height; v++) {
+                    while (row(slice, texture, v) != 0) {
+                        // take the first run of faces in the row,
+                        // then grow it along v while the next rows contain the run
+                        uint32_t bits = row(slice, texture, v);
+                        int u = std::countr_zero(bits);
+                        int w = std::countr_one(bits >> u);
+                        uint32_t run = uint32_t((uint64_t(1) << w) - 1) << u;
+
+                        int h = 1;
+                        for (; v + h < height; h++) {
+                            if ((row(slice, texture, v + h) & run) != run)
+                                break;
+                            row(slice, texture, v + h) &= ~run;
+                        }
+                        row(slice, texture, v) &= ~run;
+
+                        add_merged_quad(mesh, face, slice, u, v, w, h, texture);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void build_mesh(MeshMode mode, const MeshVolume& volume, Mesh& mesh)
+{
+    mesh.vertices.clear();
+    if (mode == MeshMode::binary)
+        build_binary_mesh(volume, mesh);
+    else if (mode == MeshMode::greedy)
+        build_greedy_mesh(volume, mesh);
+    else
+        build_naive_mesh(volume, mesh);
+
+    // quads are meshed in cells, scale their corners back up to voxels. The corners
+    // are on cell boundaries, so clamping them to the chunk's size cuts the cells
+    // on the far edges down to the voxels inside of the chunk
+    if (volume.lod() > 0) {
+        for (Vertex& vertex : mesh.vertices) {
+            IVec3 p = vertex.position();
+            IVec3 scaled(std::min(p.x << volume.lod(), CHUNK_SIZE),
+                std::min(p.y << volume.lod(), CHUNK_HEIGHT),
+                std::min(p.z << volume.lod(), CHUNK_SIZE));
+            vertex = Vertex(scaled, vertex.face(), vertex.texture());
+        }
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "chunk.h"
+
+// naive emits one quad per visible voxel face,
+// greedy merges coplanar faces with the same texture into larger quads,
+// binary builds the same mesh as greedy using bitmasks of voxel occupancy
+enum class MeshMode { naive, greedy, binary };
+
+inline const char* mesh_mode_name(MeshMode mode)
+{
+    return mode == MeshMode::naive ? "naive" : mode == MeshMode::greedy ? "greedy" : "binary";
+}
+
+// four vertices per quad, the quads' indices come from the QuadIndexBuffer
+struct Mesh {
+    std::vector<Vertex> vertices;
+};
+
+// the coarsest level of detail, voxels are merged in 2^MAX_LOD cubes
+const int MAX_LOD = 3;
+
+// A chunk's voxels surrounded by a one voxel border copied from its neighbouring
+// chunks, so that faces on the chunk's edges are culled against the voxels next to
+// them. Missing neighbours and the space above and below the chunk are air.
+//
+// Past level of detail 0 the voxels are downsampled into cells of 2^lod voxels per
+// side, the cells on the chunk's far edges are cut off by the chunk's sides. A cell
+// is solid when any of its voxels are, so the coarse volume contains the full
+// resolution one, and takes the block of its highest voxel so that grass stays on
+// top. The border around a coarse volume is always air, so its mesh closes itself
+// off along the chunk's sides. Together that leaves no cracks between neighbouring
+// chunks, whatever their levels of detail are: a full resolution chunk culls its
+// border faces against its neighbours' voxels, which are inside their coarse
+// meshes, and coarse chunks cover their own sides.
+class MeshVolume {
+public:
+    // neighbours are ordered like CHUNK_NEIGHBOURS and can be null
+    MeshVolume(const VoxelStorage& voxels,
+        const std::array<const VoxelStorage*, 4>& neighbours, int lod = 0);
+
+    // coordinates are local to the chunk, in cells, and range from -1 to the size
+    Block get(int x, int y, int z) const { return m_blocks[index(x, y, z)]; }
+
+    int lod() const { return m_lod; }
+    // the number of cells along the x and z axes and along the y axis
+    int size() const { return m_size; }
+    int height() const { return m_height; }
+
+private:
+    // merge the voxels into cells, leaving the border air
+    void downsample(const VoxelStorage& voxels);
+
+    int index(int x, int y, int z) const
+    {
+        return ((x + 1) * (m_size + 2) + (z + 1)) * (m_height + 2) + (y + 1);
+    }
+
+    int m_lod, m_size, m_height;
+    std::vector<Block> m_blocks;
+};
+
+// Build the mesh for a chunk's voxels,
+// vertex positions are relative to the chunk's origin
+void build_mesh(MeshMode mode, const MeshVolume& volume, Mesh& mesh);
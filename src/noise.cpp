@@ -0,0 +1,269 @@
+#include <cmath>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define NOISE_X86
+#include <immintrin.h>
+#endif
+
+#include "noise.h"
+
+// the 8 gradient directions a lattice point can pick from
+constexpr float GRADIENT_X[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+constexpr float GRADIENT_Y[8] = { 0, 0, 1, -1, 1, 1, -1, -1 };
+
+// the xxHash primes used to hash lattice points
+constexpr uint32_t PRIME_X = 3266489917u;
+constexpr uint32_t PRIME_Y = 668265263u;
+constexpr uint32_t PRIME_MIX = 2246822519u;
+
+// The SIMD versions below mirror the scalar version operation by operation,
+// so none of them may be compiled with FMA or reassociated arithmetic
+inline float fade(float t) { return t * t * t * (t * (t * 6 - 15) + 10); }
+
+inline float lerp(float a, float b, float t) { return a + t * (b - a); }
+
+// hash a lattice point into the index of its gradient direction
+inline int gradient_index(int x, int y, uint32_t seed)
+{
+    // xxHash, the shifts are arithmetic like in the SIMD versions.
+    // the whole lattice coordinate is hashed so the noise never repeats
+    uint32_t h = uint32_t(x) * PRIME_X + uint32_t(y) * PRIME_Y + seed;
+    h ^= uint32_t(int32_t(h) >> 15);
+    h *= PRIME_MIX;
+    h ^= uint32_t(int32_t(h) >> 13);
+    h *= PRIME_X;
+    h ^= uint32_t(int32_t(h) >> 16);
+    return h & 7;
+}
+
+inline float gradient_dot(int x, int y, uint32_t seed, float dx, float dy)
+{
+    int g = gradient_index(x, y, seed);
+    return GRADIENT_X[g] * dx + GRADIENT_Y[g] * dy;
+}
+
+float perlin_noise(float x, float y, uint32_t seed)
+{
+    // get the grid cell the point's in and
+    // the direction of the point in that grid cell
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    int X = int(fx);
+    int Y = int(fy);
+    float dx = x - fx;
+    float dy = y - fy;
+
+    // dot the gradient vectors of each corner with the direction to the point
+    float vtl = gradient_dot(X, Y, seed, dx, dy);
+    float vtr = gradient_dot(X + 1, Y, seed, dx - 1, dy);
+    float vbl = gradient_dot(X, Y + 1, seed, dx, dy - 1);
+    float vbr = gradient_dot(X + 1, Y + 1, seed, dx - 1, dy - 1);
+
+    // interpolate those values
+    float u = fade(dx);
+    float a = lerp(vtl, vtr, u);
+    float b = lerp(vbl, vbr, u);
+    float noise = lerp(a, b, fade(dy));
+
+    // normalize to a range of 0 to 1
+    return noise * 0.7f + 0.5f;
+}
+
+#ifdef NOISE_X86
+
+#define SSE41 __attribute__((target("sse4.1")))
+#define AVX2 __attribute__((target("avx2")))
+
+SSE41 inline __m128 fade(__m128 t)
+{
+    __m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+    __m128 inner
+        = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6)), _mm_set1_ps(15)), t);
+    return _mm_mul_ps(t3, _mm_add_ps(inner, _mm_set1_ps(10)));
+}
+
+SSE41 inline __m128 lerp(__m128 a, __m128 b, __m128 t)
+{
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+SSE41 inline __m128 gradient_dot(
+    __m128i x, __m128i y, __m128i seed, __m128 dx, __m128 dy)
+{
+    __m128i h = _mm_add_epi32(_mm_mullo_epi32(x, _mm_set1_epi32(PRIME_X)),
+        _mm_mullo_epi32(y, _mm_set1_epi32(PRIME_Y)));
+    h = _mm_add_epi32(h, seed);
+    h = _mm_xor_si128(h, _mm_srai_epi32(h, 15));
+    h = _mm_mullo_epi32(h, _mm_set1_epi32(PRIME_MIX));
+    h = _mm_xor_si128(h, _mm_srai_epi32(h, 13));
+    h = _mm_mullo_epi32(h, _mm_set1_epi32(PRIME_X));
+    h = _mm_xor_si128(h, _mm_srai_epi32(h, 16));
+
+    // look the gradient up with a byte shuffle: the index goes in the low byte of
+    // each lane and the other bytes are zeroed, then the byte is sign extended
+    __m128i index = _mm_or_si128(
+        _mm_and_si128(h, _mm_set1_epi32(7)), _mm_set1_epi32(int(0x80808000u)));
+    __m128i table_x = _mm_setr_epi8(1, -1, 0, 0, 1, -1, 1, -1, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i table_y = _mm_setr_epi8(0, 0, 1, -1, 1, 1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0);
+    __m128i gx = _mm_srai_epi32(_mm_slli_epi32(_mm_shuffle_epi8(table_x, index), 24), 24);
+    __m128i gy = _mm_srai_epi32(_mm_slli_epi32(_mm_shuffle_epi8(table_y, index), 24), 24);
+
+    return _mm_add_ps(
+        _mm_mul_ps(_mm_cvtepi32_ps(gx), dx), _mm_mul_ps(_mm_cvtepi32_ps(gy), dy));
+}
+
+SSE41 void perlin_noise_sse41(
+    const float* x, const float* y, float* out, int count, uint32_t seed)
+{
+    const __m128 one = _mm_set1_ps(1);
+    const __m128i one_i = _mm_set1_epi32(1);
+    const __m128i seeds = _mm_set1_epi32(seed);
+
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 fx = _mm_floor_ps(px);
+        __m128 fy = _mm_floor_ps(py);
+        __m128i X = _mm_cvttps_epi32(fx);
+        __m128i Y = _mm_cvttps_epi32(fy);
+        __m128i X1 = _mm_add_epi32(X, one_i);
+        __m128i Y1 = _mm_add_epi32(Y, one_i);
+        __m128 dx = _mm_sub_ps(px, fx);
+        __m128 dy = _mm_sub_ps(py, fy);
+        __m128 dx1 = _mm_sub_ps(dx, one);
+        __m128 dy1 = _mm_sub_ps(dy, one);
+
+        __m128 vtl = gradient_dot(X, Y, seeds, dx, dy);
+        __m128 vtr = gradient_dot(X1, Y, seeds, dx1, dy);
+        __m128 vbl = gradient_dot(X, Y1, seeds, dx, dy1);
+        __m128 vbr = gradient_dot(X1, Y1, seeds, dx1, dy1);
+
+        __m128 u = fade(dx);
+        __m128 a = lerp(vtl, vtr, u);
+        __m128 b = lerp(vbl, vbr, u);
+        __m128 noise = lerp(a, b, fade(dy));
+        noise = _mm_add_ps(_mm_mul_ps(noise, _mm_set1_ps(0.7f)), _mm_set1_ps(0.5f));
+        _mm_storeu_ps(out + i, noise);
+    }
+
+    for (; i < count; i++)
+        out[i] = perlin_noise(x[i], y[i], seed);
+}
+
+AVX2 inline __m256 fade(__m256 t)
+{
+    __m256 t3 = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+    __m256 inner = _mm256_mul_ps(
+        _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6)), _mm256_set1_ps(15)), t);
+    return _mm256_mul_ps(t3, _mm256_add_ps(inner, _mm256_set1_ps(10)));
+}
+
+AVX2 inline __m256 lerp(__m256 a, __m256 b, __m256 t)
+{
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+AVX2 inline __m256 gradient_dot(
+    __m256i x, __m256i y, __m256i seed, __m256 dx, __m256 dy)
+{
+    __m256i h = _mm256_add_epi32(_mm256_mullo_epi32(x, _mm256_set1_epi32(PRIME_X)),
+        _mm256_mullo_epi32(y, _mm256_set1_epi32(PRIME_Y)));
+    h = _mm256_add_epi32(h, seed);
+    h = _mm256_xor_si256(h, _mm256_srai_epi32(h, 15));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(PRIME_MIX));
+    h = _mm256_xor_si256(h, _mm256_srai_epi32(h, 13));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(PRIME_X));
+    h = _mm256_xor_si256(h, _mm256_srai_epi32(h, 16));
+
+    // only the low 3 bits of the hash are used by the permute
+    __m256 table_x = _mm256_loadu_ps(GRADIENT_X);
+    __m256 table_y = _mm256_loadu_ps(GRADIENT_Y);
+    __m256 gx = _mm256_permutevar8x32_ps(table_x, h);
+    __m256 gy = _mm256_permutevar8x32_ps(table_y, h);
+
+    return _mm256_add_ps(_mm256_mul_ps(gx, dx), _mm256_mul_ps(gy, dy));
+}
+
+AVX2 void perlin_noise_avx2(
+    const float* x, const float* y, float* out, int count, uint32_t seed)
+{
+    const __m256 one = _mm256_set1_ps(1);
+    const __m256i one_i = _mm256_set1_epi32(1);
+    const __m256i seeds = _mm256_set1_epi32(seed);
+
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 fx = _mm256_floor_ps(px);
+        __m256 fy = _mm256_floor_ps(py);
+        __m256i X = _mm256_cvttps_epi32(fx);
+        __m256i Y = _mm256_cvttps_epi32(fy);
+        __m256i X1 = _mm256_add_epi32(X, one_i);
+        __m256i Y1 = _mm256_add_epi32(Y, one_i);
+        __m256 dx = _mm256_sub_ps(px, fx);
+        __m256 dy = _mm256_sub_ps(py, fy);
+        __m256 dx1 = _mm256_sub_ps(dx, one);
+        __m256 dy1 = _mm256_sub_ps(dy, one);
+
+        __m256 vtl = gradient_dot(X, Y, seeds, dx, dy);
+        __m256 vtr = gradient_dot(X1, Y, seeds, dx1, dy);
+        __m256 vbl = gradient_dot(X, Y1, seeds, dx, dy1);
+        __m256 vbr = gradient_dot(X1, Y1, seeds, dx1, dy1);
+
+        __m256 u = fade(dx);
+        __m256 a = lerp(vtl, vtr, u);
+        __m256 b = lerp(vbl, vbr, u);
+        __m256 noise = lerp(a, b, fade(dy));
+        noise = _mm256_add_ps(
+            _mm256_mul_ps(noise, _mm256_set1_ps(0.7f)), _mm256_set1_ps(0.5f));
+        _mm256_storeu_ps(out + i, noise);
+    }
+
+    // finish the tail with the 4 wide version
+    perlin_noise_sse41(x + i, y + i, out + i, count - i, seed);
+}
+
+#endif
+
+NoiseBackend noise_backend()
+{
+    static const NoiseBackend backend = []() {
+#ifdef NOISE_X86
+        if (__builtin_cpu_supports("avx2"))
+            return NoiseBackend::avx2;
+        if (__builtin_cpu_supports("sse4.1"))
+            return NoiseBackend::sse41;
+#endif
+        return NoiseBackend::scalar;
+    }();
+    return backend;
+}
+
+const char* noise_backend_name(NoiseBackend backend)
+{
+    switch (backend) {
+    case NoiseBackend::scalar:
+        return "scalar";
+    case NoiseBackend::sse41:
+        return "sse4.1";
+    case NoiseBackend::avx2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+void perlin_noise(const float* x, const float* y, float* out, int count, uint32_t seed,
+    NoiseBackend backend)
+{
+#ifdef NOISE_X86
+    if (backend == NoiseBackend::avx2)
+        return perlin_noise_avx2(x, y, out, count, seed);
+    if (backend == NoiseBackend::sse41)
+        return perlin_noise_sse41(x, y, out, count, seed);
+#endif
+    for (int i = 0; i < count; i++)
+        out[i] = perlin_noise(x[i], y[i], seed);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// The instruction sets the batch noise evaluator can use
+enum class NoiseBackend { scalar, sse41, avx2 };
+
+// the fastest backend the cpu supports, checked once at startup
+NoiseBackend noise_backend();
+const char* noise_backend_name(NoiseBackend backend);
+
+// 2d perlin noise in the range of roughly 0 to 1. it doesn't repeat,
+// and different seeds give unrelated noise
+float perlin_noise(float x, float y, uint32_t seed = 0);
+
+// evaluate perlin noise at a batch of points, writing one value per point to out.
+// every backend produces results that are bit identical to the scalar version
+void perlin_noise(const float* x, const float* y, float* out, int count,
+    uint32_t seed = 0, NoiseBackend backend = noise_backend());
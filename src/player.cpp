@@ -14,8 +14,10 @@ void Player::init(Terrain* terrain)
     m_friction = 0.2;
     m_speed = 0.15;
     m_max_jump_height = 1.5;
-    m_selected_object
-        = { .position = Vec3(0, 0, 0), .selected = false, .max_select_distance = 15.0 };
+    m_selected_object = { .position = IVec3(0, 0, 0),
+        .adjacent = IVec3(0, 0, 0),
+        .selected = false,
+        .max_select_distance = 15.0 };
     m_camera.position = Vec3(m_position.x, m_position.y + m_size.y, m_position.z);
     m_terrain = terrain;
 }
@@ -105,8 +107,8 @@ void Player::find_selected_voxel()
 {
     // clang-format off
     Vec3 d = m_camera.front.norm(); // viewing direction
-    Vec3 p = m_camera.position.floor(); // current voxel position
-    Vec3 step = Vec3(d.x > 0 ? 1 : -1, d.y > 0 ? 1 : -1, d.z > 0 ? 1 : -1);
+    IVec3 p = m_camera.position.voxel(); // current voxel position
+    IVec3 step = IVec3(d.x > 0 ? 1 : -1, d.y > 0 ? 1 : -1, d.z > 0 ? 1 : -1);
 
     // distance to the next voxel on each axis
     Vec3 t_max = Vec3(
@@ -122,9 +124,11 @@ void Player::find_selected_voxel()
         d.z != 0 ? std::abs(1.0 / d.z) : INFINITY
     );
 
+    IVec3 previous = p;
     while (true) {
-        if (m_terrain->voxel_exists(p.x, p.y, p.z)) {
+        if (m_terrain->voxel_exists(p)) {
             m_selected_object.position = p;
+            m_selected_object.adjacent = previous;
             m_selected_object.selected = true;
             return;
         }
@@ -134,6 +138,7 @@ void Player::find_selected_voxel()
         if (distance > m_selected_object.max_select_distance) break;
 
         // step to the next voxel
+        previous = p;
         if (t_max.x == distance) {
             p.x += step.x;
             t_max.x += t_delta.x;
@@ -151,6 +156,10 @@ void Player::find_selected_voxel()
 
 void Player::update()
 {
+    // don't fall through terrain that hasn't been generated yet
+    if (!m_terrain->chunk_loaded(m_position.x, m_position.z))
+        return;
+
     m_vel += m_accel;
     update_position();
 
@@ -165,10 +174,32 @@ void Player::update()
     find_selected_voxel();
 }
 
-#include "utils.h"
+// check if the player's bounding box, which sits a voxel above its position
+// like in collision checks, overlaps a voxel
+bool Player::overlaps_voxel(IVec3 voxel)
+{
+    Vec3 min = m_position + Vec3(0, 1, 0);
+    Vec3 max = min + m_size;
+    return voxel.x + 1 > min.x && voxel.x < max.x && voxel.y + 1 > min.y
+        && voxel.y < max.y && voxel.z + 1 > min.z && voxel.z < max.z;
+}
+
 void Player::place_object()
 {
-    if (!m_selected_object.selected) return;
-    log("placing...");
-    // TODO: better alternatives to reconstructing the chunk mesh each time
+    IVec3 p = m_selected_object.adjacent;
+    if (!m_selected_object.selected || overlaps_voxel(p))
+        return;
+    m_terrain->set_block(p, Block::dirt);
+}
+
+void Player::remove_object()
+{
+    if (m_selected_object.selected)
+        m_terrain->set_block(m_selected_object.position, Block::air);
+}
+
+void Player::explode_object()
+{
+    if (m_selected_object.selected)
+        m_terrain->explode(Vec3(m_selected_object.position), 4);
 }
@@ -6,7 +6,8 @@
 enum class Direction { front, back, right, left, up };
 
 struct Selection {
-    Vec3 position;
+    IVec3 position;
+    IVec3 adjacent; // the empty voxel in front of the face that was looked at
     bool selected;
     float max_select_distance;
 };
@@ -16,10 +17,12 @@ public:
     void init(Terrain* terrain);
     void move(Direction direction);
     void place_object();
+    void remove_object();
+    void explode_object();
     void update();
 
     Vec3 position() { return m_position; }
-    Vec3 selected_object() { return m_selected_object.position; }
+    Vec3 selected_object() { return Vec3(m_selected_object.position); }
     void rotate(float x, float y) { m_camera.rotate(x, y); }
     Matrix4 view_matrix() { return m_camera.look_at(); }
 
@@ -27,6 +30,7 @@ private:
     void update_position();
     float apply_physics(float value, float min, float max, bool is_accel);
     void find_selected_voxel();
+    bool overlaps_voxel(IVec3 voxel);
 
     Vec3 m_vel, m_accel;
     float m_friction, m_speed;
@@ -0,0 +1,230 @@
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "codec.h"
+#include "region.h"
+
+const char REGION_MAGIC[4] = { 'V', 'X', 'R', 'G' };
+const uint32_t REGION_VERSION = 2;
+// the player only crosses a few regions at a time, the
+// rest are closed when the player has moved away from them
+const int MAX_OPEN_REGIONS = 16;
+const uint32_t TABLE_END
+    = sizeof(RegionFile::Header) + sizeof(RegionFile::Entry) * REGION_CHUNKS;
+
+inline int region_coordinate(int chunk) { return floor(chunk / float(REGION_SIZE)); }
+
+inline int region_index(IVec3 chunk_pos)
+{
+    int x = chunk_pos.x - region_coordinate(chunk_pos.x) * REGION_SIZE;
+    int z = chunk_pos.z - region_coordinate(chunk_pos.z) * REGION_SIZE;
+    return x * REGION_SIZE + z;
+}
+
+RegionFile::~RegionFile()
+{
+    if (m_map != nullptr)
+        munmap(m_map, m_map_size);
+    if (m_fd != -1)
+        close(m_fd);
+}
+
+Result RegionFile::map(size_t size)
+{
+    if (m_map != nullptr && size <= m_map_size)
+        return Result();
+    if (m_map != nullptr)
+        munmap(m_map, m_map_size);
+
+    m_map_size = 0;
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (map == MAP_FAILED) {
+        m_map = nullptr;
+        return Result("Failed to map region file: {}", std::strerror(errno));
+    }
+
+    // chunks are read in whatever order the player explores them, so readahead
+    // would mostly page in chunks that aren't needed, prefetch() hints instead
+    madvise(map, size, MADV_RANDOM);
+    m_map = (uint8_t*)map;
+    m_map_size = size;
+    return Result();
+}
+
+Result RegionFile::open(const std::string& path)
+{
+    m_fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (m_fd == -1)
+        return Result("Failed to open {}: {}", path, std::strerror(errno));
+
+    Header header;
+    ssize_t header_size = pread(m_fd, &header, sizeof(header), 0);
+    if (header_size == 0) {
+        // start a new region with an empty table
+        std::memcpy(header.magic, REGION_MAGIC, 4);
+        header.version = REGION_VERSION;
+        std::memset(m_table, 0, sizeof(m_table));
+        m_end = TABLE_END;
+
+        bool written = pwrite(m_fd, &header, sizeof(header), 0) == sizeof(header)
+            && pwrite(m_fd, m_table, sizeof(m_table), sizeof(header)) == sizeof(m_table);
+        return written ? Result() : Result("Failed to write {}", path);
+    }
+
+    if (header_size != sizeof(header)
+        || std::memcmp(header.magic, REGION_MAGIC, 4) != 0)
+        return Result("{} isn't a region file", path);
+    if (header.version != REGION_VERSION)
+        return Result("{} has unsupported version {}", path, header.version);
+    if (pread(m_fd, m_table, sizeof(m_table), sizeof(header)) != sizeof(m_table))
+        return Result("{} has a truncated chunk table", path);
+
+    struct stat info;
+    if (fstat(m_fd, &info) != 0)
+        return Result("Failed to stat {}: {}", path, std::strerror(errno));
+
+    // reading a mapping past the end of the file crashes, so every payload
+    // has to be after the table and inside of the file
+    m_end = TABLE_END;
+    for (const Entry& entry : m_table) {
+        if (entry.offset == 0)
+            continue;
+        uint64_t end = uint64_t(entry.offset) + entry.capacity;
+        if (entry.offset < TABLE_END || entry.size > entry.capacity
+            || end > uint64_t(info.st_size) || end > UINT32_MAX)
+            return Result("{} has a corrupt chunk table", path);
+        m_end = std::max(m_end, uint32_t(end));
+    }
+    return Result();
+}
+
+ResultOr<bool> RegionFile::read_chunk(IVec3 chunk_pos, VoxelStorage& voxels)
+{
+    const Entry& entry = m_table[region_index(chunk_pos)];
+    if (entry.offset == 0)
+        return false;
+
+    // pwrite and the shared mapping go through the same page cache,
+    // so the mapping only has to grow to see newly written chunks
+    Result result = map(m_end);
+    if (result.is_err())
+        return result;
+
+    if (uint64_t(entry.offset) + entry.size > m_map_size)
+        return Result("Chunk payload is past the end of the region file");
+    result = decompress_chunk(m_map + entry.offset, entry.size, voxels);
+    if (result.is_err())
+        return result;
+    return true;
+}
+
+void RegionFile::prefetch(IVec3 chunk_pos)
+{
+    const Entry& entry = m_table[region_index(chunk_pos)];
+    if (entry.offset == 0 || map(m_end).is_err())
+        return;
+
+    // madvise needs a page aligned address
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t begin = entry.offset / page * page;
+    madvise(m_map + begin, entry.offset + entry.size - begin, MADV_WILLNEED);
+}
+
+Result RegionFile::write_chunk(IVec3 chunk_pos, const VoxelStorage& voxels)
+{
+    std::vector<uint8_t> data = compress_chunk(voxels);
+    int index = region_index(chunk_pos);
+
+    // move the chunk to the end of the file when it outgrows its slot
+    Entry entry = m_table[index];
+    uint32_t end = m_end;
+    if (entry.offset == 0 || data.size() > entry.capacity) {
+        entry.offset = end;
+        entry.capacity = data.size();
+        end += data.size();
+    }
+    entry.size = data.size();
+
+    // the payload is written before the table points to it, and the table in
+    // memory only changes once both writes succeeded, so that a failed write never
+    // leaves it pointing past the end of the file, where reading the mapping crashes
+    off_t entry_offset = sizeof(Header) + sizeof(Entry) * index;
+    if (pwrite(m_fd, data.data(), data.size(), entry.offset) != ssize_t(data.size())
+        || pwrite(m_fd, &entry, sizeof(Entry), entry_offset) != sizeof(Entry))
+        return Result("Failed to write chunk payload: {}", std::strerror(errno));
+
+    m_table[index] = entry;
+    m_end = end;
+    return Result();
+}
+
+RegionStore::RegionStore(std::string directory)
+    : m_directory(std::move(directory)),
+      m_regions(MAX_OPEN_REGIONS)
+{
+}
+
+ResultOr<RegionFile*> RegionStore::region(IVec3 chunk_pos, bool create)
+{
+    IVec3 region_pos(
+        region_coordinate(chunk_pos.x), 0, region_coordinate(chunk_pos.z));
+    // taking the region out and putting it back marks it as the most recently used
+    auto open = m_regions.take(region_pos);
+    if (open.has_value()) {
+        RegionFile* region = open->get();
+        m_regions.put(region_pos, std::move(*open));
+        return region;
+    }
+
+    std::string path
+        = std::format("{}/r.{}.{}.region", m_directory, region_pos.x, region_pos.z);
+    if (!create && !std::filesystem::exists(path))
+        return nullptr;
+
+    std::error_code error;
+    std::filesystem::create_directories(m_directory, error);
+    if (error)
+        return Result("Failed to create {}: {}", m_directory, error.message());
+
+    auto file = std::make_unique<RegionFile>();
+    Result result = file->open(path);
+    if (result.is_err())
+        return result;
+
+    // the least recently used region is closed when there are too many open
+    RegionFile* region = file.get();
+    m_regions.put(region_pos, std::move(file));
+    return region;
+}
+
+ResultOr<bool> RegionStore::load(IVec3 chunk_pos, VoxelStorage& voxels)
+{
+    // don't create region files just to find out that they're empty
+    ResultOr<RegionFile*> file = region(chunk_pos, false);
+    if (file.is_err())
+        return file.error();
+    if (file.value() == nullptr)
+        return false;
+    return file.value()->read_chunk(chunk_pos, voxels);
+}
+
+void RegionStore::prefetch(IVec3 chunk_pos)
+{
+    ResultOr<RegionFile*> file = region(chunk_pos, false);
+    if (!file.is_err() && file.value() != nullptr)
+        file.value()->prefetch(chunk_pos);
+}
+
+Result RegionStore::save(IVec3 chunk_pos, const VoxelStorage& voxels)
+{
+    ResultOr<RegionFile*> file = region(chunk_pos, true);
+    if (file.is_err())
+        return file.error();
+    return file.value()->write_chunk(chunk_pos, voxels);
+}
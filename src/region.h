@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "cache.h"
+#include "chunk.h"
+#include "utils.h"
+
+// chunks per side of a region file
+const int REGION_SIZE = 16;
+const int REGION_CHUNKS = REGION_SIZE * REGION_SIZE;
+
+// A save file holding a square of REGION_SIZE x REGION_SIZE chunks.
+// The file starts with a header and a table with the offset and size of every
+// chunk's payload, followed by the payloads, which are chunks compressed with
+// compress_chunk. A rewritten chunk reuses its old slot when it fits and is
+// appended to the end of the file otherwise.
+// Chunks are written with pwrite and read through a shared memory mapping of the
+// file, so payloads are decoded straight out of the page cache without copies.
+class RegionFile {
+public:
+    RegionFile() : m_fd(-1), m_map(nullptr), m_map_size(0), m_end(0) { }
+    ~RegionFile();
+
+    // disable copy and move constructors
+    RegionFile& operator=(const RegionFile&) = delete;
+    RegionFile(const RegionFile&) = delete;
+
+    // open the region file at a path, creating it if it doesn't exist
+    Result open(const std::string& path);
+
+    // read a chunk into voxels, returns false when the chunk hasn't been saved
+    ResultOr<bool> read_chunk(IVec3 chunk_pos, VoxelStorage& voxels);
+    Result write_chunk(IVec3 chunk_pos, const VoxelStorage& voxels);
+    // hint that a chunk will be read soon so the kernel starts paging it in
+    void prefetch(IVec3 chunk_pos);
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+    };
+
+    struct Entry {
+        uint32_t offset; // 0 when the chunk hasn't been saved
+        uint32_t size;
+        uint32_t capacity; // bytes reserved for the payload
+    };
+
+private:
+    // map the whole file, remapping it once it has grown past the current mapping
+    Result map(size_t size);
+
+    int m_fd;
+    uint8_t* m_map;
+    size_t m_map_size;
+    Entry m_table[REGION_CHUNKS];
+    uint32_t m_end; // the end of the file, where new payloads are appended
+};
+
+// A world's save directory, a grid of region files.
+// Only the most recently used region files are kept open, each holds a file
+// descriptor and a mapping of the file.
+// It isn't thread safe, the terrain only uses it from its I/O thread
+class RegionStore {
+public:
+    RegionStore(std::string directory);
+
+    // an empty directory disables saving
+    bool enabled() const { return !m_directory.empty(); }
+
+    ResultOr<bool> load(IVec3 chunk_pos, VoxelStorage& voxels);
+    Result save(IVec3 chunk_pos, const VoxelStorage& voxels);
+    void prefetch(IVec3 chunk_pos);
+
+private:
+    // the open region file containing a chunk, opening it if it isn't open.
+    // null if the file doesn't exist and create is false
+    ResultOr<RegionFile*> region(IVec3 chunk_pos, bool create);
+
+    std::string m_directory;
+    LruCache<IVec3, std::unique_ptr<RegionFile>, IVec3Hasher> m_regions;
+};
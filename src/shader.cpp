@@ -1,44 +1,26 @@
+#include <cstring>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <glad/glad.h>
 
 #include "shader.h"
 
-ShaderManager::~ShaderManager() { glDeleteProgram(m_program); }
+// indexed by Uniform
+const char* UNIFORM_NAMES[] = { "textures" };
+static_assert(std::size(UNIFORM_NAMES) == size_t(Uniform::count));
 
-Result ShaderManager::load(std::string vertex_path, std::string fragment_path)
-{
-    auto result = add_shader(GL_VERTEX_SHADER, vertex_path);
-    if (result.is_err())
-        return result;
-
-    result = add_shader(GL_FRAGMENT_SHADER, fragment_path);
-    if (result.is_err())
-        return result;
-
-    return assemble();
-}
-
-void ShaderManager::use() { glUseProgram(m_program); }
-
-void ShaderManager::set_vec3(std::string name, const Vec3& value)
-{
-    int location = glGetUniformLocation(m_program, name.c_str());
-    glUniform3fv(location, 1, &value.x);
-}
-
-void ShaderManager::set_int(std::string name, const int value)
-{
-    int location = glGetUniformLocation(m_program, name.c_str());
-    glUniform1i(location, value);
-}
+// the binding point of the Frame uniform block
+const int FRAME_BINDING = 1;
 
-void ShaderManager::set_matrix4(std::string name, const Matrix4& value)
+ShaderManager::~ShaderManager()
 {
-    int location = glGetUniformLocation(m_program, name.c_str());
-    glUniformMatrix4fv(location, 1, GL_FALSE, value.m);
+    glDeleteBuffers(1, &m_frame_buffer);
+    glDeleteProgram(m_program);
 }
 
 ResultOr<std::string> read_file(std::string& path)
@@ -55,13 +37,85 @@ ResultOr<std::string> read_file(std::string& path)
     return content;
 }
 
-Result ShaderManager::add_shader(int type, std::string path)
+Result ShaderManager::load(
+    std::string vertex_path, std::string fragment_path, std::string cache_directory)
 {
-    auto result = read_file(path);
-    if (result.is_err())
-        return result.error();
+    ResultOr<std::string> vertex = read_file(vertex_path);
+    if (vertex.is_err())
+        return vertex.error();
+    ResultOr<std::string> fragment = read_file(fragment_path);
+    if (fragment.is_err())
+        return fragment.error();
+    glGenBuffers(1, &m_frame_buffer);
+
+    // a binary is only valid for the driver that produced it. Each string's
+    // length is hashed before it, so that moving text from the end of one string
+    // to the start of the next changes the key
+    std::string cache_path;
+    if (!cache_directory.empty()) {
+        std::vector<std::string_view> inputs = { vertex.value(), fragment.value() };
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+            inputs.push_back((const char*)glGetString(name));
+
+        Fnv1a fnv;
+        for (std::string_view input : inputs) {
+            fnv.add(input.size(), 8);
+            fnv.add(input);
+        }
+        cache_path = std::format("{}/{:016x}.program", cache_directory, fnv.hash);
+    }
+
+    if (cache_path.empty() || !load_binary(cache_path)) {
+        Result result = add_shader(GL_VERTEX_SHADER, vertex.value(), vertex_path);
+        if (result.is_err())
+            return result;
+        result = add_shader(GL_FRAGMENT_SHADER, fragment.value(), fragment_path);
+        if (result.is_err())
+            return result;
+        result = assemble();
+        if (result.is_err())
+            return result;
+
+        // the program works without the cache, so failing to write it isn't fatal
+        if (!cache_path.empty()) {
+            result = save_binary(cache_path);
+            if (result.is_err())
+                log(Level::warning, result.error());
+        }
+    }
+
+    for (int i = 0; i < int(Uniform::count); i++)
+        m_locations[i] = glGetUniformLocation(m_program, UNIFORM_NAMES[i]);
+    return {};
+}
+
+void ShaderManager::use() { glUseProgram(m_program); }
+
+void ShaderManager::set_int(Uniform uniform, const int value)
+{
+    glUniform1i(m_locations[int(uniform)], value);
+}
 
-    std::string source = result.value();
+void ShaderManager::set_frame(
+    const Matrix4& projection, const Matrix4& view, const Vec3& selected_world_pos)
+{
+    FrameUniforms frame;
+    std::memcpy(frame.projection, projection.m, sizeof(frame.projection));
+    std::memcpy(frame.view, view.m, sizeof(frame.view));
+    frame.selected_world_pos[0] = selected_world_pos.x;
+    frame.selected_world_pos[1] = selected_world_pos.y;
+    frame.selected_world_pos[2] = selected_world_pos.z;
+    frame.selected_world_pos[3] = 0;
+
+    // respecified every frame so the last frame's draws never have to finish first
+    glBindBuffer(GL_UNIFORM_BUFFER, m_frame_buffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(frame), &frame, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BINDING, m_frame_buffer);
+}
+
+Result ShaderManager::add_shader(
+    int type, const std::string& source, const std::string& path)
+{
     const char* source_ptr = source.c_str();
     unsigned int shader = glCreateShader(type);
     glShaderSource(shader, 1, &source_ptr, NULL);
@@ -85,6 +139,7 @@ Result ShaderManager::assemble()
     for (unsigned int shader : m_shader_ids) {
         glAttachShader(m_program, shader);
     }
+    glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(m_program);
 
     int success;
@@ -101,3 +156,62 @@ Result ShaderManager::assemble()
     m_shader_ids.clear();
     return {};
 }
+
+// a cached program is the binary's format followed by the binary
+struct ProgramHeader {
+    char magic[4];
+    uint32_t format;
+};
+
+const char PROGRAM_MAGIC[4] = { 'V', 'X', 'P', 'G' };
+
+bool ShaderManager::load_binary(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    ProgramHeader header;
+    if (!file.read((char*)&header, sizeof(header))
+        || std::memcmp(header.magic, PROGRAM_MAGIC, 4) != 0)
+        return false;
+    std::vector<char> binary(
+        (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // the driver can still reject a binary, after an update for example
+    m_program = glCreateProgram();
+    glProgramBinary(m_program, header.format, binary.data(), binary.size());
+    int success;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(m_program);
+        m_program = 0;
+    }
+    return success;
+}
+
+Result ShaderManager::save_binary(const std::string& path)
+{
+    int formats = 0, length = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    glGetProgramiv(m_program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (formats == 0 || length == 0)
+        return {}; // the driver doesn't support program binaries
+
+    ProgramHeader header;
+    std::memcpy(header.magic, PROGRAM_MAGIC, 4);
+    std::vector<char> binary(length);
+    glGetProgramBinary(m_program, length, nullptr, &header.format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+    std::ofstream file(path, std::ios::binary);
+    if (error || !file.is_open())
+        return Result("Failed to write the shader cache {}", path);
+    file.write((const char*)&header, sizeof(header));
+    file.write(binary.data(), binary.size());
+    file.close();
+    if (!file) {
+        // a partial binary would be loaded and rejected on every startup
+        std::filesystem::remove(path, error);
+        return Result("Failed to write the shader cache {}", path);
+    }
+    return {};
+}
@@ -5,20 +5,43 @@
 #include "math.h"
 #include "utils.h"
 
+// Uniforms set outside of the per frame block, their locations are looked
+// up once when the program is linked instead of by name on every call
+enum class Uniform { textures, count };
+
+// the std140 layout of the Frame uniform block in assets/shaders
+struct FrameUniforms {
+    float projection[16];
+    float view[16];
+    float selected_world_pos[4]; // std140 pads vec3s to 16 bytes
+};
+
 class ShaderManager {
 public:
+    ShaderManager() : m_program(0), m_frame_buffer(0) { }
     ~ShaderManager();
 
     void use();
-    void set_vec3(std::string name, const Vec3& value);
-    void set_int(std::string name, const int value);
-    void set_matrix4(std::string name, const Matrix4& value);
-    Result load(std::string vertex_path, std::string fragment_path);
+    void set_int(Uniform uniform, const int value);
+    // upload the uniforms shared by every draw in a frame, once per frame
+    void set_frame(const Matrix4& projection, const Matrix4& view,
+        const Vec3& selected_world_pos);
+    // Compile and link the shaders. The linked program is cached as a binary in
+    // the cache directory, keyed on a hash of the sources and the driver, and
+    // later loads use the binary instead of compiling. An empty directory
+    // disables the cache
+    Result load(std::string vertex_path, std::string fragment_path,
+        std::string cache_directory = "");
 
 private:
-    Result add_shader(int type, std::string path);
+    Result add_shader(int type, const std::string& source, const std::string& path);
     Result assemble();
+    // false when there's no usable binary at the path
+    bool load_binary(const std::string& path);
+    Result save_binary(const std::string& path);
 
     unsigned int m_program;
+    unsigned int m_frame_buffer;
+    int m_locations[int(Uniform::count)];
     std::vector<unsigned int> m_shader_ids;
 };
@@ -1,20 +1,98 @@
 #include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
 #include <glad/glad.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include "spritesheet.h"
 
+const char BAKED_MAGIC[4] = { 'V', 'X', 'T', 'X' };
+const uint32_t BAKED_VERSION = 1;
+
 Spritesheet::~Spritesheet() { glDeleteTextures(1, &m_texture); }
 
 void Spritesheet::bind(ShaderManager& shaders, int unit)
 {
     glActiveTexture(GL_TEXTURE0 + unit);
-    shaders.set_int("textures", unit);
+    shaders.set_int(Uniform::textures, unit);
     glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
 }
 
-Result Spritesheet::load(const char* path, int sprite_size, int num_sprites)
+Result Spritesheet::load(
+    const char* path, int sprite_size, int num_sprites, std::string cache_directory)
+{
+    if (cache_directory.empty()) {
+        ResultOr<std::vector<uint8_t>> baked = bake(path, sprite_size, num_sprites);
+        if (baked.is_err())
+            return baked.error();
+        return upload(baked.value().data(), baked.value().size());
+    }
+
+    // rebake when the spritesheet changes, without having to read it
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error)
+        return Result("Failed to open {}", path);
+    Fnv1a fnv;
+    fnv.add(path);
+    fnv.add(modified.time_since_epoch().count(), 8);
+    fnv.add(std::filesystem::file_size(path, error), 8);
+    fnv.add(sprite_size, 4);
+    fnv.add(num_sprites, 4);
+    std::string cache_path
+        = std::format("{}/{:016x}.texarray", cache_directory, fnv.hash);
+
+    if (std::filesystem::exists(cache_path)) {
+        Result result = load_baked(cache_path);
+        if (!result.is_err())
+            return result;
+        // rebake a cache file left behind by an older build or a failed write
+        log(Level::warning, "{}, rebaking {}", result.error(), cache_path);
+    }
+
+    ResultOr<std::vector<uint8_t>> baked = bake(path, sprite_size, num_sprites);
+    if (baked.is_err())
+        return baked.error();
+
+    // the texture doesn't need the cache, so failing to write it isn't fatal
+    std::filesystem::create_directories(cache_directory, error);
+    std::ofstream file(cache_path, std::ios::binary | std::ios::trunc);
+    file.write((const char*)baked.value().data(), baked.value().size());
+    if (error || !file)
+        log(Level::warning, "Failed to write the texture cache {}", cache_path);
+    return upload(baked.value().data(), baked.value().size());
+}
+
+Result Spritesheet::load_baked(const std::string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat info;
+    if (fd == -1 || fstat(fd, &info) != 0) {
+        if (fd != -1)
+            close(fd);
+        return Result("Failed to open {}", path);
+    }
+    if (info.st_size == 0) {
+        close(fd);
+        return Result("{} is empty", path);
+    }
+    void* map = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return Result("Failed to map {}", path);
+
+    Result result = upload((const uint8_t*)map, info.st_size);
+    munmap(map, info.st_size);
+    return result;
+}
+
+ResultOr<std::vector<uint8_t>> Spritesheet::bake(
+    const char* path, int sprite_size, int num_sprites)
 {
     stbi_set_flip_vertically_on_load(true);
 
@@ -24,19 +102,31 @@ Result Spritesheet::load(const char* path, int sprite_size, int num_sprites)
     if (spritesheet_pixels == nullptr)
         return Result("Failed to read {}", path);
 
-    glGenTextures(1, &m_texture);
-    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 7, GL_RGBA8, sprite_size, sprite_size, num_sprites);
+    // every level down to 1x1
+    int levels = 1;
+    while ((sprite_size >> (levels - 1)) > 1)
+        levels++;
+
+    BakedHeader header;
+    std::memcpy(header.magic, BAKED_MAGIC, 4);
+    header.version = BAKED_VERSION;
+    header.sprite_size = sprite_size;
+    header.layers = num_sprites;
+    header.levels = levels;
 
+    size_t total = 0;
+    for (int level = 0; level < levels; level++) {
+        int size = sprite_size >> level;
+        total += size_t(size) * size * 4 * num_sprites;
+    }
+    std::vector<uint8_t> baked(sizeof(header) + total);
+    std::memcpy(baked.data(), &header, sizeof(header));
+
+    // level 0, the sprites cropped out of the spritesheet
+    uint8_t* level_pixels = baked.data() + sizeof(header);
     int x = 0, y = 0;
     for (int i = 0; i < num_sprites; i++) {
-        // crop the specific sprite out of the spritesheet
-        unsigned char* sprite_pixels =
-            new unsigned char[sprite_size * sprite_size * 4];
+        uint8_t* sprite_pixels = level_pixels + size_t(i) * sprite_size * sprite_size * 4;
         for (int row = 0; row < sprite_size; row++) {
             int dest_index = row * sprite_size * 4;
             int src_index = ((y + row) * width + x) * 4;
@@ -44,13 +134,6 @@ Result Spritesheet::load(const char* path, int sprite_size, int num_sprites)
             std::memcpy(sprite_pixels + dest_index, spritesheet_pixels + src_index, stride);
         }
 
-        // upload the image
-        glTexSubImage3D(
-            GL_TEXTURE_2D_ARRAY, 0, 0, 0, i,
-            sprite_size, sprite_size, 1,
-            GL_RGBA, GL_UNSIGNED_BYTE, sprite_pixels);
-        delete[] sprite_pixels;
-
         // advance to the next sprite
         x += sprite_size;
         if (x >= width) {
@@ -58,8 +141,71 @@ Result Spritesheet::load(const char* path, int sprite_size, int num_sprites)
             y += sprite_size;
         }
     }
-
-    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
     stbi_image_free(spritesheet_pixels);
+
+    // each mip level averages 2x2 blocks of the level above it
+    for (int level = 1; level < levels; level++) {
+        int above = sprite_size >> (level - 1);
+        int size = sprite_size >> level;
+        uint8_t* source = level_pixels;
+        level_pixels += size_t(above) * above * 4 * num_sprites;
+
+        for (int i = 0; i < num_sprites; i++) {
+            const uint8_t* src = source + size_t(i) * above * above * 4;
+            uint8_t* dest = level_pixels + size_t(i) * size * size * 4;
+            for (int py = 0; py < size; py++) {
+                for (int px = 0; px < size; px++) {
+                    for (int c = 0; c < 4; c++) {
+                        int top = (py * 2 * above + px * 2) * 4 + c;
+                        int bottom = top + above * 4;
+                        int sum = src[top] + src[top + 4] + src[bottom] + src[bottom + 4];
+                        dest[(py * size + px) * 4 + c] = (sum + 2) / 4;
+                    }
+                }
+            }
+        }
+    }
+    return baked;
+}
+
+Result Spritesheet::upload(const uint8_t* baked, size_t size)
+{
+    BakedHeader header;
+    if (size < sizeof(header))
+        return Result("The baked texture array is truncated");
+    std::memcpy(&header, baked, sizeof(header));
+    if (std::memcmp(header.magic, BAKED_MAGIC, 4) != 0 || header.version != BAKED_VERSION)
+        return Result("The baked texture array has an unsupported format");
+
+    // check the size before creating the texture
+    size_t expected = sizeof(header);
+    for (uint32_t level = 0; level < header.levels && level < 32; level++) {
+        size_t level_size = header.sprite_size >> level;
+        expected += level_size * level_size * 4 * header.layers;
+    }
+    if (header.levels == 0 || header.levels > 32 || expected != size)
+        return Result("The baked texture array is truncated");
+
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // greedy meshed quads tile the texture once per voxel
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, header.levels, GL_RGBA8, header.sprite_size,
+        header.sprite_size, header.layers);
+
+    // the layers of a level are contiguous, so a level is uploaded in one call
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    size_t offset = sizeof(header);
+    for (uint32_t level = 0; level < header.levels; level++) {
+        int level_size = header.sprite_size >> level;
+        size_t bytes = size_t(level_size) * level_size * 4 * header.layers;
+
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, level_size, level_size,
+            header.layers, GL_RGBA, GL_UNSIGNED_BYTE, baked + offset);
+        offset += bytes;
+    }
     return {};
 }
@@ -1,13 +1,38 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include "shader.h"
 
+// The sprites of a spritesheet as the layers of a texture array.
+// Decoding the png, splitting it into layers and generating the mip levels is
+// done once and baked into a file in the cache directory, holding every mip
+// level of every layer, level by level. Later loads map the baked file and
+// upload each mip level straight out of the mapping.
 class Spritesheet {
 public:
     ~Spritesheet();
-    Result load(const char* path, int sprite_size, int num_sprites);
+    // an empty cache directory bakes the texture array in memory every load
+    Result load(const char* path, int sprite_size, int num_sprites,
+        std::string cache_directory = "");
     void bind(ShaderManager& shaders, int unit);
 
+    struct BakedHeader {
+        char magic[4];
+        uint32_t version;
+        uint32_t sprite_size;
+        uint32_t layers;
+        uint32_t levels;
+    };
+
 private:
+    // decode the spritesheet into the baked format, header included
+    ResultOr<std::vector<uint8_t>> bake(
+        const char* path, int sprite_size, int num_sprites);
+    // map a baked file and upload it
+    Result load_baked(const std::string& path);
+    Result upload(const uint8_t* baked, size_t size);
+
     unsigned int m_texture;
 };
@@ -0,0 +1,89 @@
+#include <algorithm>
+
+#include "storage.h"
+
+VoxelStorage::VoxelStorage(int size) : m_size(size) { fill(Block::air); }
+
+void VoxelStorage::fill(Block block) { fill(std::vector<Block> { block }); }
+
+void VoxelStorage::fill(const std::vector<Block>& palette)
+{
+    m_palette = palette;
+    m_bits = 1;
+    while (m_palette.size() > (size_t(1) << m_bits))
+        m_bits *= 2;
+    m_mask = (uint64_t(1) << m_bits) - 1;
+    m_data.assign((m_size * m_bits + 63) / 64, 0);
+}
+
+void VoxelStorage::fill(int begin, int end, Block block)
+{
+    // the palette index repeated across a whole word
+    uint64_t value = palette_index(block);
+    uint64_t pattern = value * (~uint64_t(0) / m_mask);
+
+    int bit = begin * m_bits;
+    int end_bit = end * m_bits;
+    while (bit < end_bit) {
+        int low = bit & 63;
+        int high = std::min(64, low + end_bit - bit);
+        uint64_t mask = high == 64 ? ~uint64_t(0) : (uint64_t(1) << high) - 1;
+        mask &= ~((uint64_t(1) << low) - 1);
+
+        uint64_t& word = m_data[bit >> 6];
+        word = (word & ~mask) | (pattern & mask);
+        bit += high - low;
+    }
+}
+
+void VoxelStorage::set(int index, Block block)
+{
+    uint64_t value = palette_index(block);
+    int bit = index * m_bits;
+    uint64_t& word = m_data[bit >> 6];
+    word &= ~(m_mask << (bit & 63));
+    word |= value << (bit & 63);
+}
+
+void VoxelStorage::unpack(Block* blocks) const
+{
+    for (int i = 0; i < m_size; i++)
+        blocks[i] = get(i);
+}
+
+size_t VoxelStorage::memory_usage() const
+{
+    return sizeof(*this) + m_palette.capacity() * sizeof(Block)
+        + m_data.capacity() * sizeof(uint64_t);
+}
+
+int VoxelStorage::palette_index(Block block)
+{
+    for (size_t i = 0; i < m_palette.size(); i++) {
+        if (m_palette[i] == block)
+            return i;
+    }
+
+    // widen the packed indices when the new entry doesn't fit
+    m_palette.push_back(block);
+    if (m_palette.size() > (size_t(1) << m_bits))
+        resize(m_bits * 2);
+    return m_palette.size() - 1;
+}
+
+void VoxelStorage::resize(int bits)
+{
+    // widths are powers of two so an index never straddles two words
+    std::vector<uint64_t> data((m_size * bits + 63) / 64, 0);
+    uint64_t mask = (uint64_t(1) << bits) - 1;
+    for (int i = 0; i < m_size; i++) {
+        int old_bit = i * m_bits;
+        uint64_t value = (m_data[old_bit >> 6] >> (old_bit & 63)) & m_mask;
+        int bit = i * bits;
+        data[bit >> 6] |= value << (bit & 63);
+    }
+
+    m_data = std::move(data);
+    m_bits = bits;
+    m_mask = mask;
+}
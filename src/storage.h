@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "block.h"
+
+// Palette compressed voxel storage.
+// Every voxel stores an index into a small palette of the block ids used in the
+// chunk. Indices are bit packed at 1, 2, 4 or 8 bits per voxel, so a uniform chunk
+// costs 1 bit per voxel and the width only grows once the palette outgrows it.
+class VoxelStorage {
+public:
+    VoxelStorage(int size);
+
+    Block get(int index) const
+    {
+        int bit = index * m_bits;
+        uint64_t word = m_data[bit >> 6];
+        return m_palette[(word >> (bit & 63)) & m_mask];
+    }
+
+    void set(int index, Block block);
+    void fill(Block block);
+    // fill the storage with the first block of a palette, with room for the rest
+    // of the palette's blocks so that setting them never has to widen the indices
+    void fill(const std::vector<Block>& palette);
+    // set the voxels from begin up to end, a word at a time
+    void fill(int begin, int end, Block block);
+
+    // copy every voxel out to an array of size() blocks
+    void unpack(Block* blocks) const;
+
+    int size() const { return m_size; }
+    int bits_per_voxel() const { return m_bits; }
+    // bytes used by the palette and packed indices
+    size_t memory_usage() const;
+
+private:
+    int palette_index(Block block);
+    void resize(int bits);
+
+    int m_size;
+    int m_bits;
+    uint64_t m_mask;
+    std::vector<Block> m_palette;
+    std::vector<uint64_t> m_data;
+};
@@ -0,0 +1,522 @@
+#include <algorithm>
+
+#include "codec.h"
+#include "terrain.h"
+
+// the most dirty chunks remeshed on the render thread in a frame
+const int MAX_FRAME_REMESHES = 8;
+// chunks this far away from the player are meshed at half resolution
+const int LOD_DISTANCE = 3;
+
+// leave a core for the render thread
+Terrain::Terrain(ResidencySettings settings, uint32_t seed, std::string save_directory)
+    : m_mesh_mode(MeshMode::binary),
+      m_lod_distance(LOD_DISTANCE),
+      m_render_path(RenderPath::indirect),
+      m_stats({ 0, 0, 0 }),
+      m_generator(seed),
+      m_arena(m_quad_indices),
+      m_settings(settings),
+      m_frame(0),
+      m_last_center(0, 0, 0),
+      m_unloaded(settings.cache_capacity),
+      m_store(std::move(save_directory)),
+      m_io(1),
+      m_jobs(std::max(1, int(std::thread::hardware_concurrency()) - 1))
+{
+}
+
+Terrain::~Terrain()
+{
+    for (auto& [chunk_pos, token] : m_generating)
+        cancel(token);
+    for (const auto& [chunk_pos, chunk] : m_chunks) {
+        if (chunk->unsaved())
+            queue_save(chunk_pos, chunk->voxels());
+    }
+    m_io.wait();
+}
+
+// distance between chunks in chunks, chunks are loaded in squares around the player
+inline int chunk_distance(IVec3 a, IVec3 b)
+{
+    return std::max(std::abs(a.x - b.x), std::abs(a.z - b.z));
+}
+
+void Terrain::load_more_chunks(float pos_x, float pos_z)
+{
+    // create new chunks around the current chunk continuously
+    const int radius = m_settings.load_radius;
+    IVec3 center = voxel_location(pos_x, pos_z).chunk();
+    m_frame++;
+
+    // the player left these chunks before they were generated
+    for (auto it = m_generating.begin(); it != m_generating.end();) {
+        if (chunk_distance(it->first, center) > radius) {
+            cancel(it->second);
+            it = m_generating.erase(it);
+        } else
+            it++;
+    }
+
+    // queue the closest chunks first
+    std::vector<IVec3> missing;
+    for (int x = -radius; x <= radius; x++) {
+        for (int z = -radius; z <= radius; z++) {
+            IVec3 chunk_pos = center + IVec3(x, 0, z);
+            auto chunk = m_chunks.find(chunk_pos);
+            if (chunk != m_chunks.end()) {
+                chunk->second->mark_used(m_frame);
+                continue;
+            }
+
+            // chunks that were unloaded recently don't need to be loaded again
+            auto data = m_unloaded.take(chunk_pos);
+            if (data.has_value()) {
+                VoxelStorage voxels(CHUNK_VOLUME);
+                Result result = decompress_chunk(data->data(), data->size(), voxels);
+                if (!result.is_err()) {
+                    add_chunk(chunk_pos, std::move(voxels), false);
+                    continue;
+                }
+                log(Level::warning, "Failed to decompress cached chunk: {}",
+                    result.error());
+            }
+            if (!m_generating.count(chunk_pos))
+                missing.push_back(chunk_pos);
+        }
+    }
+    std::sort(missing.begin(), missing.end(), [&](IVec3 a, IVec3 b) {
+        IVec3 da = a - center, db = b - center;
+        return da.x * da.x + da.z * da.z < db.x * db.x + db.z * db.z;
+    });
+
+    for (IVec3 chunk_pos : missing) {
+        CancelToken token = make_cancel_token();
+        m_generating.insert({ chunk_pos, token });
+        if (m_store.enabled())
+            queue_load(chunk_pos, token);
+        else
+            queue_generation(chunk_pos, token);
+    }
+
+    if (center != m_last_center)
+        prefetch_ahead(center);
+    m_last_center = center;
+    unload_chunks(center);
+}
+
+void Terrain::prefetch_ahead(IVec3 center)
+{
+    if (!m_store.enabled())
+        return;
+
+    IVec3 direction = center - m_last_center;
+    std::vector<IVec3> ahead;
+    int ring = m_settings.load_radius + 1;
+    for (int x = -ring; x <= ring; x++) {
+        for (int z = -ring; z <= ring; z++) {
+            bool on_ring = std::max(std::abs(x), std::abs(z)) == ring;
+            if (on_ring && x * direction.x + z * direction.z > 0)
+                ahead.push_back(center + IVec3(x, 0, z));
+        }
+    }
+
+    m_io.submit(make_cancel_token(), [this, ahead]() {
+        for (IVec3 chunk_pos : ahead)
+            m_store.prefetch(chunk_pos);
+    });
+}
+
+void Terrain::queue_load(IVec3 chunk_pos, CancelToken token)
+{
+    m_io.submit(token, [this, chunk_pos, token]() {
+        VoxelStorage voxels(CHUNK_VOLUME);
+        ResultOr<bool> found = m_store.load(chunk_pos, voxels);
+        if (found.is_err())
+            log(Level::warning, "Failed to load chunk: {}", found.error().error());
+
+        std::lock_guard lock(m_results_mutex);
+        if (!found.is_err() && found.value()) {
+            m_generated.push_back({ .position = chunk_pos,
+                .token = token,
+                .voxels = std::move(voxels),
+                .unsaved = false });
+        } else
+            m_not_saved.push_back({ chunk_pos, token });
+    });
+}
+
+void Terrain::queue_generation(IVec3 chunk_pos, CancelToken token)
+{
+    m_jobs.submit(token, [this, chunk_pos, token]() {
+        VoxelStorage voxels(CHUNK_VOLUME);
+        m_generator.generate(chunk_pos, voxels);
+
+        std::lock_guard lock(m_results_mutex);
+        m_generated.push_back({ .position = chunk_pos,
+            .token = token,
+            .voxels = std::move(voxels),
+            .unsaved = true });
+    });
+}
+
+void Terrain::queue_save(IVec3 chunk_pos, const VoxelStorage& voxels)
+{
+    if (!m_store.enabled())
+        return;
+
+    // the worker writes a copy, the chunk's voxels can change in the meantime
+    auto copy = std::make_shared<VoxelStorage>(voxels);
+    m_io.submit(make_cancel_token(), [this, chunk_pos, copy]() {
+        Result result = m_store.save(chunk_pos, *copy);
+        if (result.is_err())
+            log(Level::warning, "Failed to save chunk: {}", result.error());
+    });
+}
+
+void Terrain::unload_chunks(IVec3 center)
+{
+    std::vector<IVec3> unload;
+    std::vector<std::pair<unsigned int, IVec3>> candidates;
+    for (const auto& [chunk_pos, chunk] : m_chunks) {
+        int distance = chunk_distance(chunk_pos, center);
+        if (distance > m_settings.unload_radius)
+            unload.push_back(chunk_pos);
+        else if (distance > m_settings.load_radius)
+            candidates.push_back({ chunk->last_used(), chunk_pos });
+    }
+
+    // over budget, unload the least recently used chunks outside the load radius
+    int excess = int(m_chunks.size() - unload.size()) - m_settings.max_loaded;
+    if (excess > 0) {
+        excess = std::min(excess, int(candidates.size()));
+        std::partial_sort(candidates.begin(), candidates.begin() + excess,
+            candidates.end(), [](auto& a, auto& b) { return a.first < b.first; });
+        for (int i = 0; i < excess; i++)
+            unload.push_back(candidates[i].second);
+    }
+
+    for (IVec3 chunk_pos : unload) {
+        auto pending = m_meshing.find(chunk_pos);
+        if (pending != m_meshing.end()) {
+            cancel(pending->second);
+            m_meshing.erase(pending);
+        }
+
+        // releasing the chunk frees its gpu buffers
+        auto chunk = m_chunks.find(chunk_pos);
+        if (chunk->second->unsaved())
+            queue_save(chunk_pos, chunk->second->voxels());
+        m_unloaded.put(chunk_pos, compress_chunk(chunk->second->voxels()));
+        m_chunks.erase(chunk);
+    }
+
+    // the neighbours' border faces were culled against the unloaded chunks,
+    // queue_mesh skips the neighbours that were unloaded too
+    std::unordered_set<IVec3, IVec3Hasher> neighbours;
+    for (IVec3 chunk_pos : unload) {
+        for (IVec3 offset : CHUNK_NEIGHBOURS)
+            neighbours.insert(chunk_pos + offset);
+    }
+    for (IVec3 chunk_pos : neighbours)
+        queue_mesh(chunk_pos);
+}
+
+void Terrain::update()
+{
+    std::vector<GeneratedChunk> generated;
+    std::vector<BuiltMesh> meshed;
+    std::vector<std::pair<IVec3, CancelToken>> not_saved;
+    {
+        std::lock_guard lock(m_results_mutex);
+        generated.swap(m_generated);
+        meshed.swap(m_meshed);
+        not_saved.swap(m_not_saved);
+    }
+
+    for (auto& [chunk_pos, token] : not_saved) {
+        if (!cancelled(token))
+            queue_generation(chunk_pos, token);
+    }
+
+    for (GeneratedChunk& result : generated) {
+        auto pending = m_generating.find(result.position);
+        if (pending == m_generating.end() || pending->second != result.token)
+            continue; // cancelled after it finished
+        m_generating.erase(pending);
+        add_chunk(result.position, std::move(result.voxels), result.unsaved);
+    }
+
+    for (BuiltMesh& result : meshed) {
+        auto pending = m_meshing.find(result.position);
+        if (pending == m_meshing.end() || pending->second != result.token)
+            continue; // superseded by a newer mesh
+        m_meshing.erase(pending);
+
+        auto chunk = m_chunks.find(result.position);
+        if (chunk != m_chunks.end())
+            chunk->second->upload_mesh(result.mesh);
+    }
+
+    remesh_dirty();
+
+    // chunks streaming in and out leave gaps between the meshes
+    if (m_arena.fragmented())
+        m_arena.defragment();
+}
+
+Block Terrain::get_block(IVec3 p)
+{
+    VoxelLocation l = voxel_location(p.x, p.z);
+    auto chunk = m_chunks.find(l.chunk());
+    return chunk != m_chunks.end()
+        ? chunk->second->get_block(l.voxel_x, p.y, l.voxel_z)
+        : Block::air;
+}
+
+bool Terrain::set_block(IVec3 p, Block block)
+{
+    VoxelLocation l = voxel_location(p.x, p.z);
+    auto chunk = m_chunks.find(l.chunk());
+    if (chunk == m_chunks.end() || !Chunk::in_bounds(l.voxel_x, p.y, l.voxel_z))
+        return false;
+
+    chunk->second->set_block(l.voxel_x, p.y, l.voxel_z, block);
+    mark_dirty(l.chunk(), l.voxel_x, l.voxel_z);
+    return true;
+}
+
+void Terrain::mark_dirty(IVec3 chunk_pos, int voxel_x, int voxel_z)
+{
+    m_dirty.insert(chunk_pos);
+
+    // a voxel on the chunk's side also culls faces in the neighbour's mesh
+    if (voxel_x == 0)
+        m_dirty.insert(chunk_pos + IVec3(-1, 0, 0));
+    if (voxel_x == CHUNK_SIZE - 1)
+        m_dirty.insert(chunk_pos + IVec3(1, 0, 0));
+    if (voxel_z == 0)
+        m_dirty.insert(chunk_pos + IVec3(0, 0, -1));
+    if (voxel_z == CHUNK_SIZE - 1)
+        m_dirty.insert(chunk_pos + IVec3(0, 0, 1));
+}
+
+template <typename F> void Terrain::edit_columns(IVec3 min, IVec3 max, F edit)
+{
+    VoxelLocation first = voxel_location(min.x, min.z);
+    VoxelLocation last = voxel_location(max.x, max.z);
+    for (int chunk_x = first.chunk_x; chunk_x <= last.chunk_x; chunk_x++) {
+        for (int chunk_z = first.chunk_z; chunk_z <= last.chunk_z; chunk_z++) {
+            IVec3 chunk_pos(chunk_x, 0, chunk_z);
+            auto chunk = m_chunks.find(chunk_pos);
+            if (chunk == m_chunks.end())
+                continue;
+
+            // the part of the range inside of this chunk
+            int min_x = std::max(min.x - chunk_x * CHUNK_SIZE, 0);
+            int max_x = std::min(max.x - chunk_x * CHUNK_SIZE, CHUNK_SIZE - 1);
+            int min_z = std::max(min.z - chunk_z * CHUNK_SIZE, 0);
+            int max_z = std::min(max.z - chunk_z * CHUNK_SIZE, CHUNK_SIZE - 1);
+            for (int x = min_x; x <= max_x; x++) {
+                for (int z = min_z; z <= max_z; z++) {
+                    if (edit(*chunk->second, x, z))
+                        mark_dirty(chunk_pos, x, z);
+                }
+            }
+        }
+    }
+}
+
+void Terrain::fill_box(IVec3 min, IVec3 max, Block block)
+{
+    edit_columns(min, max, [&](Chunk& chunk, int x, int z) {
+        return chunk.fill_column(x, z, min.y, max.y + 1, block);
+    });
+}
+
+// fill the part of a chunk's column that's inside of a sphere,
+// returns false when the sphere misses the part of the column inside the chunk
+bool fill_sphere_column(
+    Chunk& chunk, int x, int z, Vec3 center, float radius, Block block)
+{
+    IVec3 world = chunk.position() + IVec3(x, 0, z);
+    float dx = world.x - center.x, dz = world.z - center.z;
+    float squared = radius * radius - dx * dx - dz * dz;
+    if (squared < 0)
+        return false;
+
+    float half = std::sqrt(squared);
+    return chunk.fill_column(
+        x, z, std::ceil(center.y - half), std::floor(center.y + half) + 1, block);
+}
+
+void Terrain::fill_sphere(Vec3 center, float radius, Block block)
+{
+    IVec3 min = (center - Vec3(radius, radius, radius)).voxel();
+    IVec3 max = (center + Vec3(radius, radius, radius)).voxel();
+    edit_columns(min, max, [&](Chunk& chunk, int x, int z) {
+        return fill_sphere_column(chunk, x, z, center, radius, block);
+    });
+}
+
+void Terrain::replace(IVec3 min, IVec3 max, Block from, Block to)
+{
+    edit_columns(min, max, [&](Chunk& chunk, int x, int z) {
+        bool changed = false;
+        for (int y = std::max(min.y, 0); y <= std::min(max.y, CHUNK_HEIGHT - 1); y++) {
+            if (chunk.get_block(x, y, z) == from) {
+                chunk.set_block(x, y, z, to);
+                changed = true;
+            }
+        }
+        return changed;
+    });
+}
+
+void Terrain::explode(Vec3 center, float radius)
+{
+    IVec3 min = (center - Vec3(radius, radius, radius)).voxel();
+    IVec3 max = (center + Vec3(radius, radius, radius)).voxel();
+    edit_columns(min, max, [&](Chunk& chunk, int x, int z) {
+        // shrink each column's radius by up to a quarter so the crater isn't round
+        IVec3 world = chunk.position() + IVec3(x, 0, z);
+        uint32_t hash = uint32_t(world.x) * 73856093u ^ uint32_t(world.z) * 19349663u;
+        float column_radius = radius * (1.0f - (hash % 256) / 1024.0f);
+        return fill_sphere_column(chunk, x, z, center, column_radius, Block::air);
+    });
+}
+
+void Terrain::remesh_dirty()
+{
+    // however many edits a chunk had, it's only meshed once
+    Mesh mesh;
+    int meshed = 0;
+    for (IVec3 chunk_pos : m_dirty) {
+        auto chunk = m_chunks.find(chunk_pos);
+        if (chunk == m_chunks.end())
+            continue;
+
+        // large bulk edits would stall the frame, the workers mesh the rest
+        if (meshed == MAX_FRAME_REMESHES) {
+            queue_mesh(chunk_pos);
+            continue;
+        }
+
+        // a mesh that a worker is building is older than the edits
+        auto pending = m_meshing.find(chunk_pos);
+        if (pending != m_meshing.end()) {
+            cancel(pending->second);
+            m_meshing.erase(pending);
+        }
+
+        build_mesh(m_mesh_mode, mesh_volume(chunk_pos, *chunk->second), mesh);
+        chunk->second->upload_mesh(mesh);
+        meshed++;
+    }
+    m_dirty.clear();
+}
+
+void Terrain::add_chunk(IVec3 chunk_pos, VoxelStorage voxels, bool unsaved)
+{
+    auto chunk = std::make_shared<Chunk>(chunk_pos, std::move(voxels), m_arena);
+    chunk->set_lod(chunk_lod(chunk_pos));
+    chunk->mark_used(m_frame);
+    chunk->set_unsaved(unsaved);
+    m_chunks.insert({ chunk_pos, chunk });
+
+    // the new chunk hides faces on its neighbours' borders, so remesh those too
+    queue_mesh(chunk_pos);
+    for (IVec3 offset : CHUNK_NEIGHBOURS)
+        queue_mesh(chunk_pos + offset);
+}
+
+void Terrain::wait_until_loaded()
+{
+    while (!m_generating.empty() || !m_meshing.empty()) {
+        m_io.wait();
+        m_jobs.wait();
+        update();
+    }
+}
+
+void Terrain::render(const Frustum& frustum)
+{
+    m_stats = { .tested = 0, .culled = 0, .drawn = 0 };
+    m_draws.clear();
+    for (const auto& [chunk_pos, chunk] : m_chunks) {
+        // the old mesh is drawn until the new one is built
+        int lod = chunk_lod(chunk_pos);
+        if (chunk->lod() != lod) {
+            chunk->set_lod(lod);
+            queue_mesh(chunk_pos);
+        }
+
+        m_stats.tested++;
+        if (!frustum.intersects(chunk->bounds_min(), chunk->bounds_max())) {
+            m_stats.culled++;
+            continue;
+        }
+
+        chunk->draw(m_draws);
+        m_stats.drawn++;
+    }
+
+    m_arena.bind();
+    m_draws.submit(m_render_path);
+}
+
+void Terrain::set_mesh_mode(MeshMode mode)
+{
+    m_mesh_mode = mode;
+    for (const auto& [chunk_pos, _] : m_chunks)
+        queue_mesh(chunk_pos);
+}
+
+int Terrain::chunk_lod(IVec3 chunk_pos) const
+{
+    int distance = chunk_distance(chunk_pos, m_last_center);
+    int lod = 0;
+    while (m_lod_distance > 0 && lod < MAX_LOD && distance >= m_lod_distance << lod)
+        lod++;
+    return lod;
+}
+
+MeshVolume Terrain::mesh_volume(IVec3 chunk_pos, const Chunk& chunk)
+{
+    std::array<const VoxelStorage*, 4> neighbours;
+    for (int i = 0; i < 4; i++) {
+        auto neighbour = m_chunks.find(chunk_pos + CHUNK_NEIGHBOURS[i]);
+        neighbours[i]
+            = neighbour != m_chunks.end() ? &neighbour->second->voxels() : nullptr;
+    }
+    return MeshVolume(chunk.voxels(), neighbours, chunk.lod());
+}
+
+void Terrain::queue_mesh(IVec3 chunk_pos)
+{
+    auto chunk = m_chunks.find(chunk_pos);
+    if (chunk == m_chunks.end())
+        return;
+
+    // snapshot the voxels on this thread so the worker
+    // never reads chunks that are being modified
+    auto volume = std::make_shared<MeshVolume>(mesh_volume(chunk_pos, *chunk->second));
+
+    // an older mesh of this chunk is out of date
+    auto pending = m_meshing.find(chunk_pos);
+    if (pending != m_meshing.end())
+        cancel(pending->second);
+
+    CancelToken token = make_cancel_token();
+    m_meshing[chunk_pos] = token;
+    MeshMode mode = m_mesh_mode;
+    m_jobs.submit(token, [this, chunk_pos, token, volume, mode]() {
+        Mesh mesh;
+        build_mesh(mode, *volume, mesh);
+
+        std::lock_guard lock(m_results_mutex);
+        m_meshed.push_back(
+            { .position = chunk_pos, .token = token, .mesh = std::move(mesh) });
+    });
+}
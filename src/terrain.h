@@ -1,24 +1,58 @@
 #pragma once
 
 #include <memory>
-
-#include "chunk.h"
+#include <unordered_set>
+
+#include "cache.h"
+#include "camera.h"
+#include "generator.h"
+#include "jobs.h"
+#include "mesher.h"
+#include "region.h"
+
+// Radii are in chunks around the player's chunk.
+// Chunks within the load radius are loaded and chunks past the unload radius are
+// unloaded. The gap between the two keeps chunks near a chunk border from being
+// unloaded and reloaded as the player walks back and forth across it.
+struct ResidencySettings {
+    int load_radius = 2;
+    int unload_radius = 4;
+    // the most chunks kept loaded, past this the least recently
+    // used chunks outside of the load radius are unloaded
+    int max_loaded = 64;
+    // unloaded chunks' voxels are kept in memory, compressed, up to this
+    // many chunks, so that revisited chunks don't have to be loaded again
+    int cache_capacity = 256;
+};
 
 struct VoxelLocation {
-    float chunk_x, chunk_z;
-    float voxel_x, voxel_z;
+    int chunk_x, chunk_z;
+    int voxel_x, voxel_z;
+
+    IVec3 chunk() const { return IVec3(chunk_x, 0, chunk_z); }
+};
+
+struct RenderStats {
+    int tested; // chunks checked against the view frustum
+    int culled; // chunks outside of the view frustum
+    int drawn;
 };
 
 class Terrain {
 public:
-    Terrain() { }
+    // chunks are saved to and loaded from region files in the save
+    // directory, an empty directory disables saving
+    Terrain(ResidencySettings settings = {}, uint32_t seed = 0,
+        std::string save_directory = "");
+    // saves the chunks that have changed
+    ~Terrain();
 
     VoxelLocation voxel_location(float x, float z)
     {
-        float chunk_x = floor(x / float(CHUNK_SIZE));
-        float chunk_z = floor(z / float(CHUNK_SIZE));
-        float voxel_x = floor(x - chunk_x * CHUNK_SIZE);
-        float voxel_z = floor(z - chunk_z * CHUNK_SIZE);
+        int chunk_x = floor(x / float(CHUNK_SIZE));
+        int chunk_z = floor(z / float(CHUNK_SIZE));
+        int voxel_x = floor(x) - chunk_x * CHUNK_SIZE;
+        int voxel_z = floor(z) - chunk_z * CHUNK_SIZE;
         return {
             .chunk_x = chunk_x, .chunk_z = chunk_z, .voxel_x = voxel_x, .voxel_z = voxel_z
         };
@@ -27,18 +61,18 @@ public:
     float surface_y(float x, float z)
     {
         VoxelLocation l = voxel_location(x, z);
-        auto chunk = m_chunks.find(Vec3(l.chunk_x, 0, l.chunk_z));
+        auto chunk = m_chunks.find(l.chunk());
         return chunk != m_chunks.end()
             ? chunk->second->get_surface_y(l.voxel_x, l.voxel_z)
             : -1;
     }
 
-    bool voxel_exists(float x, float y, float z)
+    bool voxel_exists(IVec3 p)
     {
-        VoxelLocation l = voxel_location(x, z);
-        auto chunk = m_chunks.find(Vec3(l.chunk_x, 0, l.chunk_z));
+        VoxelLocation l = voxel_location(p.x, p.z);
+        auto chunk = m_chunks.find(l.chunk());
         return chunk != m_chunks.end()
-            ? chunk->second->voxel_present(Vec3(l.voxel_x, y, l.voxel_z))
+            ? chunk->second->voxel_present(IVec3(l.voxel_x, p.y, l.voxel_z))
             : false;
     }
 
@@ -59,7 +93,7 @@ public:
         for (int x = min_x; x <= max_x; x++) {
             for (int y = min_y; y <= max_y; y++) {
                 for (int z = min_z; z <= max_z; z++) {
-                    if (voxel_exists(x, y, z))
+                    if (voxel_exists(IVec3(x, y, z)))
                         return true;
                 }
             }
@@ -68,29 +102,132 @@ public:
         return false;
     }
 
-    void load_more_chunks(float pos_x, float pos_z)
+    // voxel positions are in world space, voxels of chunks
+    // that aren't loaded and outside of the world are air
+    Block get_block(IVec3 p);
+    // change a voxel and mark the chunks whose meshes it's part of as dirty,
+    // returns false when the voxel's chunk isn't loaded
+    bool set_block(IVec3 p, Block block);
+
+    // Bulk edits, they change whole column ranges at once and mark each chunk they
+    // touch as dirty once, so it's remeshed once however many voxels changed.
+    // Boxes include both corners, voxels in chunks that aren't loaded are skipped
+    void fill_box(IVec3 min, IVec3 max, Block block);
+    void fill_sphere(Vec3 center, float radius, Block block);
+    void carve_sphere(Vec3 center, float radius)
     {
-        // create new chunks around the current chunk continuously
-        const int radius = 2;
-        VoxelLocation l = voxel_location(pos_x, pos_z);
-
-        for (int x = -radius; x <= radius; x += 1) {
-            for (int z = -radius; z <= radius; z++) {
-                Vec3 chunk_pos(l.chunk_x + x, 0, l.chunk_z + z);
-                if (!m_chunks.count(chunk_pos)) {
-                    auto chunk = std::make_shared<Chunk>(chunk_pos);
-                    m_chunks.insert({ chunk_pos, chunk });
-                }
-            }
-        }
+        fill_sphere(center, radius, Block::air);
     }
+    void replace(IVec3 min, IVec3 max, Block from, Block to);
+    // carve a crater with a ragged edge
+    void explode(Vec3 center, float radius);
 
-    void render()
+    // true once the chunk containing the position has been generated
+    bool chunk_loaded(float x, float z)
     {
-        for (const auto& [_, chunk] : m_chunks)
-            chunk->render();
+        return m_chunks.count(voxel_location(x, z).chunk());
     }
 
+    // queue generation for the chunks around the position that aren't loaded yet,
+    // cancel queued chunks that are no longer around it and unload far away chunks
+    void load_more_chunks(float pos_x, float pos_z);
+    // add the chunks and upload the meshes that the workers have finished,
+    // then remesh the chunks that were edited since the last update
+    void update();
+    // block until every queued chunk is generated and meshed
+    void wait_until_loaded();
+
+    // draw the chunks that are inside the view frustum, remeshing the chunks
+    // whose level of detail changed as the player moved
+    void render(const Frustum& frustum);
+    RenderStats render_stats() const { return m_stats; }
+    ArenaStats arena_stats() const { return m_arena.stats(); }
+
+    RenderPath render_path() const { return m_render_path; }
+    void set_render_path(RenderPath path) { m_render_path = path; }
+
+    // chunks lod_distance chunks away from the player are meshed at half their
+    // resolution, which halves again every time the distance doubles. 0 meshes
+    // every chunk at full resolution
+    void set_lod_distance(int distance) { m_lod_distance = distance; }
+
+    MeshMode mesh_mode() const { return m_mesh_mode; }
+    // switch mesher, remeshing every loaded chunk
+    void set_mesh_mode(MeshMode mode);
+
 private:
-    std::unordered_map<Vec3, std::shared_ptr<Chunk>, Vec3Hasher> m_chunks;
+    struct GeneratedChunk {
+        IVec3 position;
+        CancelToken token;
+        VoxelStorage voxels;
+        bool unsaved; // false when the chunk was loaded from disk
+    };
+
+    struct BuiltMesh {
+        IVec3 position;
+        CancelToken token;
+        Mesh mesh;
+    };
+
+    // look for a chunk on disk on the I/O thread, falling back to generating it
+    void queue_load(IVec3 chunk_pos, CancelToken token);
+    void queue_generation(IVec3 chunk_pos, CancelToken token);
+    void queue_save(IVec3 chunk_pos, const VoxelStorage& voxels);
+    // page in the saved chunks just past the load radius in the direction
+    // the player is moving, so they're in memory by the time they're loaded
+    void prefetch_ahead(IVec3 center);
+    // rebuild a chunk's mesh on a worker, culling its
+    // border faces against the neighbouring chunks
+    void queue_mesh(IVec3 chunk_pos);
+    // the chunk's voxels and the neighbouring voxels along its sides
+    MeshVolume mesh_volume(IVec3 chunk_pos, const Chunk& chunk);
+    // mark a chunk dirty, along with the neighbour a voxel column on its side borders
+    void mark_dirty(IVec3 chunk_pos, int voxel_x, int voxel_z);
+    // call edit(chunk, x, z) with the local coordinates of every column of the loaded
+    // chunks in a world space range, edit returns true when it changed the column
+    template <typename F> void edit_columns(IVec3 min, IVec3 max, F edit);
+    // mesh the dirty chunks on this thread so that edits show up in the next frame,
+    // past a budget they're handed to the workers instead
+    void remesh_dirty();
+    // add a chunk and queue meshes for it and the neighbours it borders
+    void add_chunk(IVec3 chunk_pos, VoxelStorage voxels, bool unsaved);
+    void unload_chunks(IVec3 center);
+    // the level of detail for a chunk, by its distance from the player
+    int chunk_lod(IVec3 chunk_pos) const;
+
+    MeshMode m_mesh_mode;
+    int m_lod_distance;
+    RenderPath m_render_path;
+    RenderStats m_stats;
+    TerrainGenerator m_generator;
+    QuadIndexBuffer m_quad_indices;
+    // declared before the chunks, which free their meshes from it
+    VertexArena m_arena;
+    DrawList m_draws;
+    std::unordered_map<IVec3, std::shared_ptr<Chunk>, IVec3Hasher> m_chunks;
+
+    ResidencySettings m_settings;
+    unsigned int m_frame;
+    IVec3 m_last_center;
+    LruCache<IVec3, std::vector<uint8_t>, IVec3Hasher> m_unloaded;
+
+    // jobs that are queued or running, by chunk position
+    std::unordered_map<IVec3, CancelToken, IVec3Hasher> m_generating;
+    std::unordered_map<IVec3, CancelToken, IVec3Hasher> m_meshing;
+    // chunks with edits that haven't been remeshed yet
+    std::unordered_set<IVec3, IVec3Hasher> m_dirty;
+
+    // results handed back from the workers
+    std::mutex m_results_mutex;
+    std::vector<GeneratedChunk> m_generated;
+    std::vector<BuiltMesh> m_meshed;
+    // chunks the I/O thread didn't find on disk, they have to be generated
+    std::vector<std::pair<IVec3, CancelToken>> m_not_saved;
+
+    // only used from the I/O thread
+    RegionStore m_store;
+    // a single worker so that region file reads and writes happen in order
+    JobPool m_io;
+    // declared last so the workers stop before the state they use is destroyed
+    JobPool m_jobs;
 };
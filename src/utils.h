@@ -1,8 +1,10 @@
 #pragma once
 
+#include <cstdint>
 #include <format>
 #include <iostream>
 #include <string>
+#include <string_view>
 
 // Error types
 class Result {
@@ -43,6 +45,25 @@ private:
     Result m_result;
 };
 
+// 64 bit FNV-1a hash
+struct Fnv1a {
+    uint64_t hash = 14695981039346656037ull;
+
+    void add(uint64_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++) {
+            hash ^= (value >> (i * 8)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    }
+
+    void add(std::string_view data)
+    {
+        for (char c : data)
+            add(uint8_t(c), 1);
+    }
+};
+
 // Logging
 enum class Level { info, warning, error, fatal };
 
@@ -1,67 +1,55 @@
 #pragma once
 
-#include <array>
-#include <unordered_map>
+#include <cstdint>
 
 #include "math.h"
 
+// A chunk mesh vertex packed into 32 bits:
+// - bits 0 to 17 hold the vertex's x, y and z position relative to the chunk's
+//   origin, 6 bits each. Positions are voxel corners, so they range from 0 to the
+//   chunk's size (inclusive)
+// - bits 18 to 20 hold the id of the face the vertex belongs to
+// - bits 21 to 28 hold the index into the block texture array
+// The vertex shader unpacks the vertex and derives the world position,
+// normal and texture coordinates from it.
 struct Vertex {
-    // vertex position
-    float vx, vy, vz;
-    // texture coordinates
-    // w is the index into the cube spritesheet texture array
-    float u, v, w;
-    // object position in world space, used for object picking
-    float wx, wy, wz;
-};
-
-// map a face direction to a the triangle vertices that make up that face
-using VoxelFaces = std::unordered_map<Vec3, std::array<Vertex, 4>, Vec3Hasher>;
-inline VoxelFaces get_voxel_faces()
-{
-    // clang-format off
-    // using 0.5 so that the voxel is 1x1x1
-    VoxelFaces voxel_faces;
-    voxel_faces[Vec3(1, 0, 0)] = { // right face
-        Vertex { 0.5, -0.5, -0.5,  1.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex { 0.5,  0.5, -0.5,  1.0, 1.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex { 0.5,  0.5,  0.5 , 0.0, 1.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex { 0.5, -0.5,  0.5 , 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }
-    };
+    Vertex() : data(0) { }
 
-    voxel_faces[Vec3(-1, 0, 0)] = { // left face
-        Vertex { -0.5, -0.5, -0.5, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex { -0.5, -0.5,  0.5, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex { -0.5,  0.5,  0.5, 1.0, 1.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex { -0.5,  0.5, -0.5, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0 }
-    };
+    Vertex(const IVec3& position, int face, int texture)
+        : data(uint32_t(position.x) | uint32_t(position.y) << 6
+              | uint32_t(position.z) << 12 | uint32_t(face) << 18
+              | uint32_t(texture) << 21)
+    {
+    }
 
-    voxel_faces[Vec3(0, 1, 0)] = { // top face
-        Vertex { -0.5, 0.5, -0.5, 0.0, 1.0, 1.0, 0.0, 0.0, 0.0 },
-        Vertex { -0.5, 0.5,  0.5, 0.0, 0.0, 1.0, 0.0, 0.0, 0.0 },
-        Vertex {  0.5, 0.5,  0.5, 1.0, 0.0, 1.0, 0.0, 0.0, 0.0 },
-        Vertex {  0.5, 0.5, -0.5, 1.0, 1.0, 1.0, 0.0, 0.0, 0.0 }
-    };
+    IVec3 position() const { return IVec3(data & 63, (data >> 6) & 63, (data >> 12) & 63); }
+    int face() const { return (data >> 18) & 7; }
+    int texture() const { return (data >> 21) & 255; }
 
-    voxel_faces[Vec3(0, -1, 0)] = { // bottom face
-        Vertex { -0.5, -0.5, -0.5, 0.0, 0.0, 2.0, 0.0, 0.0, 0.0 },
-        Vertex {  0.5, -0.5, -0.5, 1.0, 0.0, 2.0, 0.0, 0.0, 0.0 },
-        Vertex {  0.5, -0.5,  0.5, 1.0, 1.0, 2.0, 0.0, 0.0, 0.0 },
-        Vertex { -0.5, -0.5,  0.5, 0.0, 1.0, 2.0, 0.0, 0.0, 0.0 }
-    };
+    uint32_t data;
+};
 
-    voxel_faces[Vec3(0, 0, 1)] = { // front face
-        Vertex { -0.5, -0.5, 0.5, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex {  0.5, -0.5, 0.5, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex {  0.5,  0.5, 0.5, 1.0, 1.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex { -0.5,  0.5, 0.5, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0 }
-    };
+static_assert(sizeof(Vertex) == 4);
+
+// the direction each face of a voxel points in, indexed by face id
+// clang-format off
+const IVec3 FACE_NORMALS[6] = {
+    IVec3( 1,  0,  0), // right face
+    IVec3(-1,  0,  0), // left face
+    IVec3( 0,  1,  0), // top face
+    IVec3( 0, -1,  0), // bottom face
+    IVec3( 0,  0,  1), // front face
+    IVec3( 0,  0, -1), // back face
+};
 
-    voxel_faces[Vec3(0, 0, -1)] = { // back face
-        Vertex { -0.5, -0.5, -0.5, 1.0, 0.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex { -0.5 , 0.5, -0.5, 1.0, 1.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex {  0.5 , 0.5, -0.5, 0.0, 1.0, 0.0, 0.0, 0.0, 0.0 },
-        Vertex {  0.5, -0.5, -0.5, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 }
-    };
-    return voxel_faces;
-}
+// the corners of each face of a voxel relative to the voxel's minimum corner,
+// in counter clockwise order when looking at the face
+const IVec3 FACE_CORNERS[6][4] = {
+    { IVec3(1, 0, 0), IVec3(1, 1, 0), IVec3(1, 1, 1), IVec3(1, 0, 1) }, // right face
+    { IVec3(0, 0, 0), IVec3(0, 0, 1), IVec3(0, 1, 1), IVec3(0, 1, 0) }, // left face
+    { IVec3(0, 1, 0), IVec3(0, 1, 1), IVec3(1, 1, 1), IVec3(1, 1, 0) }, // top face
+    { IVec3(0, 0, 0), IVec3(1, 0, 0), IVec3(1, 0, 1), IVec3(0, 0, 1) }, // bottom face
+    { IVec3(0, 0, 1), IVec3(1, 0, 1), IVec3(1, 1, 1), IVec3(0, 1, 1) }, // front face
+    { IVec3(0, 0, 0), IVec3(0, 1, 0), IVec3(1, 1, 0), IVec3(1, 0, 0) }, // back face
+};
+// clang-format on